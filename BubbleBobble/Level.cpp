@@ -27,3 +27,8 @@ std::vector<mv::vec2i> Level::block_positions() const
 
 	return retval;
 }
+
+mv::CollisionShape<2>::Tilemap Level::tilemap(const mv::vec2f& tile_size) const
+{
+	return mv::CollisionShape<2>::Tilemap(_width, _height, tile_size, this->_cells);
+}
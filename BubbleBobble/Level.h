@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "BinaryReader.h"
+#include "CollisionShape.h"
 #include "Vector.h"
 
 class Level
@@ -18,6 +19,10 @@ private:
 
 public:
 	std::vector<mv::vec2i> block_positions() const;
+	/**
+		\brief get the blocks of the level as a single shape
+	*/
+	mv::CollisionShape<2>::Tilemap tilemap(const mv::vec2f& tile_size) const;
 };
 
 mv::BinaryReader& operator>>(mv::BinaryReader& br, Level& level);
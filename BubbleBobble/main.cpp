@@ -6,6 +6,7 @@
 #include <iostream>
 #include "Universe.h"
 #include "Entity.h"
+#include "Collider.h"
 #include "SpriteRenderComponent.h"
 #include "ResourceManager.h"
 #include "Texture.h"
@@ -29,7 +30,13 @@ int main(int, char**)
 	for (mv::size_type i = 0; i < 100; ++i) {
 		level_reader >> levels[i];
 	}
-	auto block_positions = levels[0].block_positions();
+
+	// the whole level is a single static collider instead of an entity per block
+	auto& level = mv::Multiverse::create_entity<2>(universe.id(), mv::Transform2D{}, true);
+	mv::Collider<2> level_collider;
+	level_collider.set_shape(levels[0].tilemap({ 8.f, 8.f }));
+	level_collider.set_response(mv::CollisionLayer::layer1, mv::CollisionResponse::block);
+	level.add_collider(std::move(level_collider));
 
 	mv::Multiverse::run();
 	return 0;
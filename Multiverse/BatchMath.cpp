@@ -0,0 +1,405 @@
+#include "MultiversePCH.h"
+#include "BatchMath.h"
+
+#include <initializer_list>
+
+#include "Simd.h" // lane types
+
+
+namespace
+{
+	using mv::simd::KernelLanes;
+	using mv::simd::ScalarLanes;
+	using mv::simd::transform_row;
+
+
+	/**
+		\brief sine and cosine of x
+
+		x is reduced to r in [-pi/4, pi/4] by the nearest multiple q of pi/2, with pi/2 split in three parts so q * pi/2 is exact.
+		Both are then minimax polynomials in r, swapped and negated according to the quadrant q mod 4.
+	*/
+	template <typename Lanes>
+	void lane_sincos(typename Lanes::value_type x, typename Lanes::value_type& sine, typename Lanes::value_type& cosine)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type q{ Lanes::round(Lanes::mul(x, Lanes::set(0.636619772f))) };
+		value_type r{ Lanes::sub(x, Lanes::mul(q, Lanes::set(1.5703125f))) };
+		r = Lanes::sub(r, Lanes::mul(q, Lanes::set(4.837512969970703125e-4f)));
+		r = Lanes::sub(r, Lanes::mul(q, Lanes::set(7.54978995489188216e-8f)));
+		value_type z{ Lanes::mul(r, r) };
+
+		value_type s{ Lanes::add(Lanes::set(8.3321608736e-3f), Lanes::mul(z, Lanes::set(-1.9515295891e-4f))) };
+		s = Lanes::add(Lanes::set(-1.6666654611e-1f), Lanes::mul(z, s));
+		s = Lanes::add(r, Lanes::mul(Lanes::mul(r, z), s));
+
+		value_type c{ Lanes::add(Lanes::set(-1.388731625493765e-3f), Lanes::mul(z, Lanes::set(2.443315711809948e-5f))) };
+		c = Lanes::add(Lanes::set(4.166664568298827e-2f), Lanes::mul(z, c));
+		c = Lanes::add(Lanes::sub(Lanes::set(1.f), Lanes::mul(Lanes::set(0.5f), z)), Lanes::mul(Lanes::mul(z, z), c));
+
+		typename Lanes::mask_type swap{ Lanes::bit(q, 1) };
+		sine = Lanes::select(swap, c, s);
+		cosine = Lanes::select(swap, s, c);
+		sine = Lanes::select(Lanes::bit(q, 2), Lanes::negate(sine), sine);
+		cosine = Lanes::select(Lanes::bit(Lanes::add(q, Lanes::set(1.f)), 2), Lanes::negate(cosine), cosine);
+	}
+
+	template <typename Lanes>
+	void sincos_lanes(const float* angles, float* sines, float* cosines, mv::size_type begin, mv::size_type end)
+	{
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			typename Lanes::value_type s, c;
+			lane_sincos<Lanes>(Lanes::load(angles + i), s, c);
+			Lanes::store(sines + i, s);
+			Lanes::store(cosines + i, c);
+		}
+	}
+
+	/**
+		\brief compose matrices into the columns of rows, 6 fields of width lanes each, stored as in Transform<2>::transform_matrix
+	*/
+	template <typename Lanes>
+	void compose_lanes(const float* translate_x, const float* translate_y, const float* rotate, const float* scale_x, const float* scale_y,
+		float* rows)
+	{
+		typename Lanes::value_type s, c;
+		lane_sincos<Lanes>(Lanes::load(rotate), s, c);
+		typename Lanes::value_type sx{ Lanes::load(scale_x) };
+		typename Lanes::value_type sy{ Lanes::load(scale_y) };
+		Lanes::store(rows + 0 * Lanes::width, Lanes::mul(sx, c));
+		Lanes::store(rows + 1 * Lanes::width, Lanes::negate(Lanes::mul(sy, s)));
+		Lanes::store(rows + 2 * Lanes::width, Lanes::load(translate_x));
+		Lanes::store(rows + 3 * Lanes::width, Lanes::mul(sx, s));
+		Lanes::store(rows + 4 * Lanes::width, Lanes::mul(sy, c));
+		Lanes::store(rows + 5 * Lanes::width, Lanes::load(translate_y));
+	}
+
+	template <typename Lanes>
+	void compose_range(const float* translate_x, const float* translate_y, const float* rotate, const float* scale_x, const float* scale_y,
+		mv::size_type begin, mv::size_type end, mv::mat3f* out)
+	{
+		float rows[6 * Lanes::width];
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			compose_lanes<Lanes>(translate_x + i, translate_y + i, rotate + i, scale_x + i, scale_y + i, rows);
+			for (mv::size_type lane = 0; lane < Lanes::width; ++lane) {
+				mv::mat3f& m = out[i + lane];
+				for (unsigned int r = 0; r < 2; ++r) {
+					for (unsigned int c = 0; c < 3; ++c) {
+						m.at(r, c) = rows[(r * 3 + c) * Lanes::width + lane];
+					}
+				}
+				m.at(2, 0) = 0.f;
+				m.at(2, 1) = 0.f;
+				m.at(2, 2) = 1.f;
+			}
+		}
+	}
+
+	/**
+		\brief compose matrices into the columns of rows, 12 fields of width lanes each, stored as in Transform<3>::transform_matrix
+	*/
+	template <typename Lanes>
+	void compose_lanes(const mv::TransformArrays<3>& t, mv::size_type i, float* rows)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type x{ Lanes::load(t.rotate_x.data() + i) };
+		value_type y{ Lanes::load(t.rotate_y.data() + i) };
+		value_type z{ Lanes::load(t.rotate_z.data() + i) };
+		value_type w{ Lanes::load(t.rotate_w.data() + i) };
+		value_type sx{ Lanes::load(t.scale_x.data() + i) };
+		value_type sy{ Lanes::load(t.scale_y.data() + i) };
+		value_type sz{ Lanes::load(t.scale_z.data() + i) };
+		value_type one{ Lanes::set(1.f) };
+		value_type two{ Lanes::set(2.f) };
+		value_type xx{ Lanes::mul(x, x) }, yy{ Lanes::mul(y, y) }, zz{ Lanes::mul(z, z) };
+		value_type xy{ Lanes::mul(x, y) }, xz{ Lanes::mul(x, z) }, yz{ Lanes::mul(y, z) };
+		value_type wx{ Lanes::mul(w, x) }, wy{ Lanes::mul(w, y) }, wz{ Lanes::mul(w, z) };
+		value_type fields[12]{
+			Lanes::mul(sx, Lanes::sub(one, Lanes::mul(two, Lanes::add(yy, zz)))),
+			Lanes::mul(Lanes::mul(sy, two), Lanes::sub(xy, wz)),
+			Lanes::mul(Lanes::mul(sz, two), Lanes::add(xz, wy)),
+			Lanes::load(t.translate_x.data() + i),
+			Lanes::mul(Lanes::mul(sx, two), Lanes::add(xy, wz)),
+			Lanes::mul(sy, Lanes::sub(one, Lanes::mul(two, Lanes::add(xx, zz)))),
+			Lanes::mul(Lanes::mul(sz, two), Lanes::sub(yz, wx)),
+			Lanes::load(t.translate_y.data() + i),
+			Lanes::mul(Lanes::mul(sx, two), Lanes::sub(xz, wy)),
+			Lanes::mul(Lanes::mul(sy, two), Lanes::add(yz, wx)),
+			Lanes::mul(sz, Lanes::sub(one, Lanes::mul(two, Lanes::add(xx, yy)))),
+			Lanes::load(t.translate_z.data() + i)
+		};
+		for (unsigned int f = 0; f < 12; ++f) {
+			Lanes::store(rows + f * Lanes::width, fields[f]);
+		}
+	}
+
+	template <typename Lanes>
+	void compose_range(const mv::TransformArrays<3>& t, mv::size_type begin, mv::size_type end, mv::mat4f* out)
+	{
+		float rows[12 * Lanes::width];
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			compose_lanes<Lanes>(t, i, rows);
+			for (mv::size_type lane = 0; lane < Lanes::width; ++lane) {
+				mv::mat4f& m = out[i + lane];
+				for (unsigned int r = 0; r < 3; ++r) {
+					for (unsigned int c = 0; c < 4; ++c) {
+						m.at(r, c) = rows[(r * 4 + c) * Lanes::width + lane];
+					}
+				}
+				m.at(3, 0) = 0.f;
+				m.at(3, 1) = 0.f;
+				m.at(3, 2) = 0.f;
+				m.at(3, 3) = 1.f;
+			}
+		}
+	}
+
+
+	template <typename Lanes>
+	void transform_range(const mv::mat3f& t, const float* x, const float* y, mv::size_type begin, mv::size_type end, float* out_x, float* out_y)
+	{
+		typename Lanes::value_type m[6];
+		for (unsigned int r = 0; r < 2; ++r) {
+			for (unsigned int c = 0; c < 3; ++c) {
+				m[r * 3 + c] = Lanes::set(t.at(r, c));
+			}
+		}
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			typename Lanes::value_type px{ Lanes::load(x + i) };
+			typename Lanes::value_type py{ Lanes::load(y + i) };
+			Lanes::store(out_x + i, transform_row<Lanes>(m[0], m[1], m[2], px, py));
+			Lanes::store(out_y + i, transform_row<Lanes>(m[3], m[4], m[5], px, py));
+		}
+	}
+
+	template <typename Lanes>
+	typename Lanes::value_type lerp(typename Lanes::value_type a, typename Lanes::value_type b, typename Lanes::value_type alpha)
+	{
+		return Lanes::add(a, Lanes::mul(Lanes::sub(b, a), alpha));
+	}
+
+	template <typename Lanes>
+	void lerp_range(const float* from, const float* to, float alpha, mv::size_type begin, mv::size_type end, float* out)
+	{
+		typename Lanes::value_type a{ Lanes::set(alpha) };
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			Lanes::store(out + i, lerp<Lanes>(Lanes::load(from + i), Lanes::load(to + i), a));
+		}
+	}
+
+	/**
+		\brief interpolate angles along the shorter way around, the difference is wrapped to [-pi, pi] first
+	*/
+	template <typename Lanes>
+	void angle_range(const float* from, const float* to, float alpha, mv::size_type begin, mv::size_type end, float* out)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type a{ Lanes::set(alpha) };
+		value_type turn{ Lanes::set(6.28318530718f) };
+		value_type inverse_turn{ Lanes::set(0.159154943092f) };
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			value_type r{ Lanes::load(from + i) };
+			value_type d{ Lanes::sub(Lanes::load(to + i), r) };
+			d = Lanes::sub(d, Lanes::mul(Lanes::round(Lanes::mul(d, inverse_turn)), turn));
+			Lanes::store(out + i, Lanes::add(r, Lanes::mul(d, a)));
+		}
+	}
+
+	/**
+		\brief normalised linear interpolation of unit quaternions, to is negated when needed to take the shorter arc
+	*/
+	template <typename Lanes>
+	void nlerp_range(const mv::TransformArrays<3>& from, const mv::TransformArrays<3>& to, float alpha,
+		mv::size_type begin, mv::size_type end, mv::TransformArrays<3>& out)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type a{ Lanes::set(alpha) };
+		value_type zero{ Lanes::set(0.f) };
+		for (mv::size_type i = begin; i + Lanes::width <= end; i += Lanes::width) {
+			value_type x0{ Lanes::load(from.rotate_x.data() + i) }, x1{ Lanes::load(to.rotate_x.data() + i) };
+			value_type y0{ Lanes::load(from.rotate_y.data() + i) }, y1{ Lanes::load(to.rotate_y.data() + i) };
+			value_type z0{ Lanes::load(from.rotate_z.data() + i) }, z1{ Lanes::load(to.rotate_z.data() + i) };
+			value_type w0{ Lanes::load(from.rotate_w.data() + i) }, w1{ Lanes::load(to.rotate_w.data() + i) };
+			value_type dot{ Lanes::add(Lanes::add(Lanes::add(Lanes::mul(x0, x1), Lanes::mul(y0, y1)), Lanes::mul(z0, z1)), Lanes::mul(w0, w1)) };
+			typename Lanes::mask_type flip{ Lanes::less(dot, zero) };
+			value_type x{ lerp<Lanes>(x0, Lanes::select(flip, Lanes::negate(x1), x1), a) };
+			value_type y{ lerp<Lanes>(y0, Lanes::select(flip, Lanes::negate(y1), y1), a) };
+			value_type z{ lerp<Lanes>(z0, Lanes::select(flip, Lanes::negate(z1), z1), a) };
+			value_type w{ lerp<Lanes>(w0, Lanes::select(flip, Lanes::negate(w1), w1), a) };
+			value_type length{ Lanes::sqrt(Lanes::add(Lanes::add(Lanes::add(Lanes::mul(x, x), Lanes::mul(y, y)), Lanes::mul(z, z)), Lanes::mul(w, w))) };
+			Lanes::store(out.rotate_x.data() + i, Lanes::div(x, length));
+			Lanes::store(out.rotate_y.data() + i, Lanes::div(y, length));
+			Lanes::store(out.rotate_z.data() + i, Lanes::div(z, length));
+			Lanes::store(out.rotate_w.data() + i, Lanes::div(w, length));
+		}
+	}
+
+	/**
+		\brief first index not covered by the kernel lanes
+	*/
+	mv::size_type kernel_end(mv::size_type count)
+	{
+		return count / KernelLanes::width * KernelLanes::width;
+	}
+}
+
+
+
+void mv::TransformArrays<2>::clear()
+{
+	this->translate_x.clear();
+	this->translate_y.clear();
+	this->rotate.clear();
+	this->scale_x.clear();
+	this->scale_y.clear();
+}
+
+void mv::TransformArrays<2>::reserve(size_type count)
+{
+	this->translate_x.reserve(count);
+	this->translate_y.reserve(count);
+	this->rotate.reserve(count);
+	this->scale_x.reserve(count);
+	this->scale_y.reserve(count);
+}
+
+void mv::TransformArrays<2>::resize(size_type count)
+{
+	this->translate_x.resize(count);
+	this->translate_y.resize(count);
+	this->rotate.resize(count);
+	this->scale_x.resize(count);
+	this->scale_y.resize(count);
+}
+
+void mv::TransformArrays<2>::push_back(const Transform<2>& transform)
+{
+	this->translate_x.push_back(transform.translate.x());
+	this->translate_y.push_back(transform.translate.y());
+	this->rotate.push_back(transform.rotate);
+	this->scale_x.push_back(transform.scale.x());
+	this->scale_y.push_back(transform.scale.y());
+}
+
+mv::size_type mv::TransformArrays<2>::size() const
+{
+	return static_cast<size_type>(this->rotate.size());
+}
+
+
+void mv::TransformArrays<3>::clear()
+{
+	for (std::vector<float>* field : { &this->translate_x, &this->translate_y, &this->translate_z,
+		&this->rotate_x, &this->rotate_y, &this->rotate_z, &this->rotate_w, &this->scale_x, &this->scale_y, &this->scale_z }) {
+		field->clear();
+	}
+}
+
+void mv::TransformArrays<3>::reserve(size_type count)
+{
+	for (std::vector<float>* field : { &this->translate_x, &this->translate_y, &this->translate_z,
+		&this->rotate_x, &this->rotate_y, &this->rotate_z, &this->rotate_w, &this->scale_x, &this->scale_y, &this->scale_z }) {
+		field->reserve(count);
+	}
+}
+
+void mv::TransformArrays<3>::resize(size_type count)
+{
+	for (std::vector<float>* field : { &this->translate_x, &this->translate_y, &this->translate_z,
+		&this->rotate_x, &this->rotate_y, &this->rotate_z, &this->rotate_w, &this->scale_x, &this->scale_y, &this->scale_z }) {
+		field->resize(count);
+	}
+}
+
+void mv::TransformArrays<3>::push_back(const Transform<3>& transform)
+{
+	this->translate_x.push_back(transform.translate.x());
+	this->translate_y.push_back(transform.translate.y());
+	this->translate_z.push_back(transform.translate.z());
+	this->rotate_x.push_back(transform.rotate.x);
+	this->rotate_y.push_back(transform.rotate.y);
+	this->rotate_z.push_back(transform.rotate.z);
+	this->rotate_w.push_back(transform.rotate.w);
+	this->scale_x.push_back(transform.scale.x());
+	this->scale_y.push_back(transform.scale.y());
+	this->scale_z.push_back(transform.scale.z());
+}
+
+mv::size_type mv::TransformArrays<3>::size() const
+{
+	return static_cast<size_type>(this->rotate_w.size());
+}
+
+
+
+void mv::batch::sincos(const float* angles, float* sines, float* cosines, size_type count)
+{
+	size_type split = kernel_end(count);
+	sincos_lanes<KernelLanes>(angles, sines, cosines, 0, split);
+	sincos_lanes<ScalarLanes>(angles, sines, cosines, split, count);
+}
+
+void mv::batch::sincos(float angle, float& sine, float& cosine)
+{
+	lane_sincos<ScalarLanes>(angle, sine, cosine);
+}
+
+void mv::batch::compose(const float* translate_x, const float* translate_y, const float* rotate, const float* scale_x, const float* scale_y,
+	size_type count, mat3f* out)
+{
+	size_type split = kernel_end(count);
+	compose_range<KernelLanes>(translate_x, translate_y, rotate, scale_x, scale_y, 0, split, out);
+	compose_range<ScalarLanes>(translate_x, translate_y, rotate, scale_x, scale_y, split, count, out);
+}
+
+void mv::batch::compose(const TransformArrays<2>& transforms, mat3f* out)
+{
+	if (transforms.size() == 0) {
+		return;
+	}
+	compose(transforms.translate_x.data(), transforms.translate_y.data(), transforms.rotate.data(),
+		transforms.scale_x.data(), transforms.scale_y.data(), transforms.size(), out);
+}
+
+void mv::batch::compose(const TransformArrays<3>& transforms, mat4f* out)
+{
+	size_type count = transforms.size();
+	size_type split = kernel_end(count);
+	compose_range<KernelLanes>(transforms, 0, split, out);
+	compose_range<ScalarLanes>(transforms, split, count, out);
+}
+
+void mv::batch::interpolate(const TransformArrays<2>& from, const TransformArrays<2>& to, float alpha, TransformArrays<2>& out)
+{
+	size_type count = from.size();
+	size_type split = kernel_end(count);
+	out.resize(count);
+	for (auto field : { &TransformArrays<2>::translate_x, &TransformArrays<2>::translate_y,
+		&TransformArrays<2>::scale_x, &TransformArrays<2>::scale_y }) {
+		lerp_range<KernelLanes>((from.*field).data(), (to.*field).data(), alpha, 0, split, (out.*field).data());
+		lerp_range<ScalarLanes>((from.*field).data(), (to.*field).data(), alpha, split, count, (out.*field).data());
+	}
+	angle_range<KernelLanes>(from.rotate.data(), to.rotate.data(), alpha, 0, split, out.rotate.data());
+	angle_range<ScalarLanes>(from.rotate.data(), to.rotate.data(), alpha, split, count, out.rotate.data());
+}
+
+void mv::batch::interpolate(const TransformArrays<3>& from, const TransformArrays<3>& to, float alpha, TransformArrays<3>& out)
+{
+	size_type count = from.size();
+	size_type split = kernel_end(count);
+	out.resize(count);
+	for (auto field : { &TransformArrays<3>::translate_x, &TransformArrays<3>::translate_y, &TransformArrays<3>::translate_z,
+		&TransformArrays<3>::scale_x, &TransformArrays<3>::scale_y, &TransformArrays<3>::scale_z }) {
+		lerp_range<KernelLanes>((from.*field).data(), (to.*field).data(), alpha, 0, split, (out.*field).data());
+		lerp_range<ScalarLanes>((from.*field).data(), (to.*field).data(), alpha, split, count, (out.*field).data());
+	}
+	nlerp_range<KernelLanes>(from, to, alpha, 0, split, out);
+	nlerp_range<ScalarLanes>(from, to, alpha, split, count, out);
+}
+
+void mv::batch::transform_points(const mat3f& transform, const float* x, const float* y, size_type count, float* out_x, float* out_y)
+{
+	size_type split = kernel_end(count);
+	transform_range<KernelLanes>(transform, x, y, 0, split, out_x, out_y);
+	transform_range<ScalarLanes>(transform, x, y, split, count, out_x, out_y);
+}
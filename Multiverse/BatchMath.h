@@ -0,0 +1,109 @@
+#pragma once
+#include "setup.h"
+
+#include <vector>
+
+#include "Matrix.h"
+#include "Transform.h"
+
+namespace mv
+{
+	/**
+		\brief transforms stored as structure of arrays, one array per component
+	*/
+	template <uint dims>
+	struct TransformArrays;
+
+	template <>
+	struct TransformArrays<2>
+	{
+		std::vector<float> translate_x;
+		std::vector<float> translate_y;
+		std::vector<float> rotate;
+		std::vector<float> scale_x;
+		std::vector<float> scale_y;
+
+		void clear();
+		void reserve(size_type count);
+		void resize(size_type count);
+		void push_back(const Transform<2>& transform);
+		size_type size() const;
+	};
+
+	template <>
+	struct TransformArrays<3>
+	{
+		std::vector<float> translate_x;
+		std::vector<float> translate_y;
+		std::vector<float> translate_z;
+		std::vector<float> rotate_x; // unit quaternion
+		std::vector<float> rotate_y;
+		std::vector<float> rotate_z;
+		std::vector<float> rotate_w;
+		std::vector<float> scale_x;
+		std::vector<float> scale_y;
+		std::vector<float> scale_z;
+
+		void clear();
+		void reserve(size_type count);
+		void resize(size_type count);
+		void push_back(const Transform<3>& transform);
+		size_type size() const;
+	};
+
+	/**
+		\brief streaming kernels over arrays of floats
+
+		The kernels process four elements at a time with SSE when MV_SIMD is enabled and the remainder one at a time;
+		both paths perform the same operations in the same order and give identical results.
+		Sines and cosines come from a polynomial approximation accurate to a few ulp for angles up to about 1e5 radians,
+		so composed matrices can differ from Transform::transform_matrix in the last bits.
+	*/
+	namespace batch
+	{
+		/**
+			\brief calculate sine and cosine of count angles
+		*/
+		void sincos(const float* angles, float* sines, float* cosines, size_type count);
+		/**
+			\brief calculate sine and cosine of one angle, with the same approximation as the batch version
+		*/
+		void sincos(float angle, float& sine, float& cosine);
+
+		/**
+			\brief compose count transforms into matrices, the same layout as Transform<2>::transform_matrix
+		*/
+		void compose(const float* translate_x, const float* translate_y, const float* rotate, const float* scale_x, const float* scale_y,
+			size_type count, mat3f* out);
+		/**
+			\brief compose all transforms of transforms into matrices
+			\param out receives transforms.size() matrices
+		*/
+		void compose(const TransformArrays<2>& transforms, mat3f* out);
+		/**
+			\brief compose all transforms of transforms into matrices, the same layout as Transform<3>::transform_matrix
+			\param out receives transforms.size() matrices
+		*/
+		void compose(const TransformArrays<3>& transforms, mat4f* out);
+
+		/**
+			\brief interpolate between two sets of transforms of the same size, alpha 0 gives from and 1 gives to
+			\param out resized to the size of from, may not be from or to
+
+			Translations and scales are interpolated linearly and rotations along the shorter way around.
+		*/
+		void interpolate(const TransformArrays<2>& from, const TransformArrays<2>& to, float alpha, TransformArrays<2>& out);
+		/**
+			\brief interpolate between two sets of transforms of the same size, rotations by normalised linear interpolation
+			\see interpolate
+		*/
+		void interpolate(const TransformArrays<3>& from, const TransformArrays<3>& to, float alpha, TransformArrays<3>& out);
+
+		/**
+			\brief transform count points by one affine transformation
+			\param out_x may be x
+			\param out_y may be y
+		*/
+		void transform_points(const mat3f& transform, const float* x, const float* y, size_type count, float* out_x, float* out_y);
+	}
+}
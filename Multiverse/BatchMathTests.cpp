@@ -0,0 +1,83 @@
+#include "MultiversePCH.h"
+#include <catch.hpp>
+#include "BatchMath.h"
+
+#include <vector>
+
+using namespace mv;
+
+// 7 elements, so the SSE kernels take the first 4 and the scalar remainder the last 3
+
+TEST_CASE("Batched sine and cosine match the single angle version", "BatchMath")
+{
+	const float angles[7]{ -3.f, -0.5f, 0.f, 0.25f, 1.5f, 4.f, 100.f };
+	float sines[7], cosines[7];
+	batch::sincos(angles, sines, cosines, 7);
+	for (unsigned int i = 0; i < 7; ++i) {
+		float sine, cosine;
+		batch::sincos(angles[i], sine, cosine);
+		REQUIRE(sines[i] == sine);
+		REQUIRE(cosines[i] == cosine);
+		REQUIRE(sine == Approx(std::sin(angles[i])).margin(1e-6f));
+		REQUIRE(cosine == Approx(std::cos(angles[i])).margin(1e-6f));
+	}
+}
+
+TEST_CASE("Batched point transforms match Matrix * Vector", "BatchMath")
+{
+	mat3f t{ mat3f::transform(vec2f{ 1.5f, -2.f }, 0.7f, vec2f{ 2.f, 0.5f }) };
+	float x[7], y[7];
+	for (unsigned int i = 0; i < 7; ++i) {
+		x[i] = static_cast<float>(i) * 1.3f - 4.f;
+		y[i] = static_cast<float>(i) * -0.6f + 1.f;
+	}
+	float out_x[7], out_y[7];
+	batch::transform_points(t, x, y, 7, out_x, out_y);
+	for (unsigned int i = 0; i < 7; ++i) {
+		vec2f p{ t * vec3f{ x[i], y[i], 1.f } };
+		REQUIRE(out_x[i] == p.x());
+		REQUIRE(out_y[i] == p.y());
+	}
+}
+
+TEST_CASE("Batched composition gives the same matrices in SSE and scalar lanes", "BatchMath")
+{
+	std::vector<Transform<2>> list2;
+	std::vector<Transform<3>> list3;
+	TransformArrays<2> transforms2;
+	TransformArrays<3> transforms3;
+	for (unsigned int i = 0; i < 7; ++i) {
+		float f = static_cast<float>(i);
+		Transform<2> t2;
+		t2.translate = vec2f{ f, -f };
+		t2.rotate = 0.4f * f - 1.f;
+		t2.scale = vec2f{ 1.f + 0.1f * f, 2.f - 0.2f * f };
+		transforms2.push_back(t2);
+		list2.push_back(t2);
+		Transform<3> t3;
+		t3.translate = vec3f{ f, 2.f * f, -f };
+		t3.rotate = glm::angleAxis(0.3f * f, glm::normalize(glm::vec3{ 1.f, f, 2.f }));
+		t3.scale = vec3f{ 1.f + 0.1f * f, 1.f, 2.f - 0.2f * f };
+		transforms3.push_back(t3);
+		list3.push_back(t3);
+	}
+	std::vector<mat3f> out2(7);
+	std::vector<mat4f> out3(7);
+	batch::compose(transforms2, out2.data());
+	batch::compose(transforms3, out3.data());
+
+	// composing one transform at a time only ever takes the scalar path
+	for (unsigned int i = 0; i < 7; ++i) {
+		TransformArrays<2> single2;
+		single2.push_back(list2[i]);
+		mat3f m2;
+		batch::compose(single2, &m2);
+		REQUIRE(out2[i] == m2);
+
+		TransformArrays<3> single3;
+		single3.push_back(list3[i]);
+		mat4f m3;
+		batch::compose(single3, &m3);
+		REQUIRE(out3[i] == m3);
+	}
+}
@@ -29,6 +29,16 @@ void mv::Collider<dims>::set_response(CollisionLayer layer, CollisionResponse re
 	this->_response_mask &= ~static_cast<uint>(0b11u << (2u * static_cast<uint>(layer)));
 	// set new response
 	this->_response_mask |= static_cast<uint>((0b11u & static_cast<uint>(response)) << (2u * static_cast<uint>(layer)));
+	if (response == CollisionResponse::ignore)
+		this->_response_layers &= static_cast<CollisionLayerMask>(~collision_layer_mask(layer));
+	else
+		this->_response_layers |= collision_layer_mask(layer);
+}
+
+template <mv::uint dims>
+void mv::Collider<dims>::set_continuous(bool continuous)
+{
+	this->_continuous = continuous;
 }
 
 
@@ -44,11 +54,40 @@ mv::CollisionResponse mv::Collider<dims>::response(CollisionLayer layer) const
 	return static_cast<CollisionResponse>((this->_response_mask >> (2u * static_cast<uint>(layer))) & 0b11u);
 }
 
+template <mv::uint dims>
+bool mv::Collider<dims>::is_continuous() const
+{
+	return this->_continuous;
+}
+
+template <mv::uint dims>
+mv::CollisionLayerMask mv::Collider<dims>::response_layers() const
+{
+	return this->_response_layers;
+}
+
+template <mv::uint dims>
+const typename mv::CollisionShape<dims>::Placement& mv::Collider<dims>::placement() const
+{
+	return this->_placement;
+}
+
+
+template <mv::uint dims>
+void mv::Collider<dims>::_raise_overlap(id_type entity_id, bool begin) const
+{
+	if (begin) {
+		this->begin_overlap.raise(entity_id);
+	}
+	else {
+		this->end_overlap.raise(entity_id);
+	}
+}
 
 template <mv::uint dims>
-const std::set<mv::id_type>& mv::Collider<dims>::overlaps() const
+void mv::Collider<dims>::_raise_hit(const Contact<dims>& contact) const
 {
-	return this->_overlaps;
+	this->hit.raise(contact);
 }
 
 
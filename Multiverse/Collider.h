@@ -1,14 +1,15 @@
 #pragma once
 #include "setup.h"
 #include "CollisionShape.h"
+#include "Contact.h"
 #include "Event.h"
 
-#include <set>
-
 namespace mv
 {
 	template <uint dims>
 	class Entity;
+	template <uint dims>
+	class Universe;
 
 	enum class CollisionResponse : byte
 	{
@@ -19,31 +20,69 @@ namespace mv
 		layer1, layer2, layer3, layer4, layer5, layer6, layer7, layer8
 	};
 
+	using CollisionLayerMask = byte; // one bit per CollisionLayer
+	constexpr CollisionLayerMask all_collision_layers = static_cast<CollisionLayerMask>(0xFF);
+
+	constexpr CollisionLayerMask collision_layer_mask(CollisionLayer layer)
+	{
+		return static_cast<CollisionLayerMask>(1 << static_cast<byte>(layer));
+	}
+
 	template <uint dims>
 	class Collider
 	{
 		friend Entity<dims>;
+		friend Universe<dims>;
 
 	private:
 		CollisionShape<dims> _shape;
-		CollisionLayer _layer;
-		uint _response_mask;
-
-		std::set<id_type> _overlaps;
+		typename CollisionShape<dims>::Placement _placement; // world placement of the shape, refreshed when the entity moves
+		CollisionLayer _layer = CollisionLayer::layer1;
+		uint _response_mask = 0;
+		CollisionLayerMask _response_layers = 0; // layers with a response other than ignore
+		bool _continuous = false;
 
 	public:
-		Event<Collider> begin_overlap;
-		Event<Collider> end_overlap;
-		Event<Collider> hit;
+		/**
+			\brief raised after the collision update with the id of the entity this collider started overlapping
+		*/
+		Event<Collider, id_type> begin_overlap;
+		/**
+			\brief raised after the collision update with the id of the entity this collider stopped overlapping
+		*/
+		Event<Collider, id_type> end_overlap;
+		/**
+			\brief raised after the collision update for every blocking contact of this collider
+		*/
+		Event<Collider, const Contact<dims>&> hit;
 
 		void set_shape(const CollisionShape<dims>& shape);
 		void set_shape(CollisionShape<dims>&& shape);
 		void set_layer(CollisionLayer layer);
 		void set_response(CollisionLayer layer, CollisionResponse response);
+		/**
+			\brief enable continuous collision detection
+
+			Continuous colliders are swept along the movement of their entity each update and stopped at the first
+			blocking collider they touch, so fast movers cannot pass through thin colliders between two updates.
+			Overlaps are still only tested at the end of the movement.
+		*/
+		void set_continuous(bool continuous);
 
 		CollisionLayer layer() const;
 		CollisionResponse response(CollisionLayer layer) const;
+		bool is_continuous() const;
+		/**
+			\brief get layers this collider does not ignore
+		*/
+		CollisionLayerMask response_layers() const;
+		/**
+			\brief get world placement of the shape as of the last gridspace update
+		*/
+		const typename CollisionShape<dims>::Placement& placement() const;
 
-		const std::set<id_type>& overlaps() const;
+	private:
+		void _raise_overlap(id_type entity_id, bool begin) const;
+		void _raise_hit(const Contact<dims>& contact) const;
 	};
 }
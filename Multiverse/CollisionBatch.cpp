@@ -0,0 +1,359 @@
+#include "MultiversePCH.h"
+#include "CollisionBatch.h"
+
+#include <limits>	// numeric_limits
+
+#include "Simd.h" // lane types
+
+
+namespace
+{
+	using mv::simd::KernelLanes;
+	using mv::simd::transform_row;
+
+
+	enum RectangleField : unsigned int
+	{
+		rectangle_a_lower_x, rectangle_a_lower_y, rectangle_a_upper_x, rectangle_a_upper_y,
+		rectangle_b_lower_x, rectangle_b_lower_y, rectangle_b_upper_x, rectangle_b_upper_y,
+		rectangle_ta, // a to b space, 6 fields
+		rectangle_tb = rectangle_ta + 6, // b to a space
+		rectangle_t0 = rectangle_tb + 6, // a to world space
+		rectangle_t1 = rectangle_t0 + 6, // b to world space
+		rectangle_field_count = rectangle_t1 + 6
+	};
+
+	enum PointEllipseField : unsigned int
+	{
+		point_ellipse_ta, // point to ellipse space, 6 fields
+		point_ellipse_x = point_ellipse_ta + 6,
+		point_ellipse_y,
+		point_ellipse_t0 = point_ellipse_y + 1, // ellipse to world space, 6 fields
+		point_ellipse_sign = point_ellipse_t0 + 6, // -1 if the point is the first shape of the pair
+		point_ellipse_field_count
+	};
+
+	enum OutputField : unsigned int
+	{
+		output_hit, output_mtv_x, output_mtv_y, output_field_count
+	};
+
+
+	/**
+		\brief get lane count padded to the kernel width
+	*/
+	mv::size_type padded_lane_count(mv::size_type count)
+	{
+		return (count + KernelLanes::width - 1) / KernelLanes::width * KernelLanes::width;
+	}
+
+	/**
+		\brief store the top two rows of an affine transformation in 6 fields
+	*/
+	void store_affine(float* lane, mv::size_type stride, const mv::mat3f& m)
+	{
+		for (unsigned int r = 0; r < 2; ++r) {
+			for (unsigned int c = 0; c < 3; ++c) {
+				lane[(r * 3 + c) * stride] = m.at(r, c);
+			}
+		}
+	}
+
+
+	/**
+		\brief lane version of the overlap helper of CollisionShape.cpp
+	*/
+	template <typename Lanes>
+	typename Lanes::mask_type overlap(typename Lanes::value_type amin, typename Lanes::value_type amax,
+		typename Lanes::value_type bmin, typename Lanes::value_type bmax, typename Lanes::value_type& overlap)
+	{
+		typename Lanes::value_type oab = Lanes::sub(amax, bmin);
+		typename Lanes::value_type oba = Lanes::sub(bmax, amin);
+		overlap = Lanes::select(Lanes::less(oab, oba), Lanes::negate(oab), oba);
+		return Lanes::both(Lanes::greater_equal(oab, Lanes::set(0.f)), Lanes::greater_equal(oba, Lanes::set(0.f)));
+	}
+
+	/**
+		\brief get bounds of a rectangle transformed by the 6 fields starting at m
+	*/
+	template <typename Lanes>
+	void rectangle_bounds(const typename Lanes::value_type* m,
+		typename Lanes::value_type lower_x, typename Lanes::value_type lower_y, typename Lanes::value_type upper_x, typename Lanes::value_type upper_y,
+		typename Lanes::value_type* lower, typename Lanes::value_type* upper)
+	{
+		const typename Lanes::value_type corners[4][2]{ { lower_x, lower_y }, { upper_x, lower_y }, { upper_x, upper_y }, { lower_x, upper_y } };
+		lower[0] = lower[1] = Lanes::set(std::numeric_limits<float>::infinity());
+		upper[0] = upper[1] = Lanes::set(-std::numeric_limits<float>::infinity());
+		for (const auto& corner : corners) {
+			for (unsigned int r = 0; r < 2; ++r) {
+				typename Lanes::value_type v = transform_row<Lanes>(m[r * 3], m[r * 3 + 1], m[r * 3 + 2], corner[0], corner[1]);
+				lower[r] = Lanes::min(v, lower[r]);
+				upper[r] = Lanes::max(v, upper[r]);
+			}
+		}
+	}
+
+	/**
+		\brief test Lanes::width rectangle-rectangle pairs, mirrors CollisionShape<2>::Rectangle::collides(const Rectangle&)
+	*/
+	template <typename Lanes>
+	void rectangle_kernel(const float* lanes, mv::size_type stride, float* output)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type f[rectangle_field_count];
+		for (unsigned int i = 0; i < rectangle_field_count; ++i) {
+			f[i] = Lanes::load(lanes + i * stride);
+		}
+
+		value_type o[4];
+		value_type lower[2], upper[2];
+		rectangle_bounds<Lanes>(f + rectangle_ta, f[rectangle_a_lower_x], f[rectangle_a_lower_y], f[rectangle_a_upper_x], f[rectangle_a_upper_y], lower, upper);
+		typename Lanes::mask_type hit = Lanes::both(
+			overlap<Lanes>(lower[0], upper[0], f[rectangle_b_lower_x], f[rectangle_b_upper_x], o[0]),
+			overlap<Lanes>(lower[1], upper[1], f[rectangle_b_lower_y], f[rectangle_b_upper_y], o[1]));
+		rectangle_bounds<Lanes>(f + rectangle_tb, f[rectangle_b_lower_x], f[rectangle_b_lower_y], f[rectangle_b_upper_x], f[rectangle_b_upper_y], lower, upper);
+		hit = Lanes::both(hit, Lanes::both(
+			overlap<Lanes>(f[rectangle_a_lower_x], f[rectangle_a_upper_x], lower[0], upper[0], o[2]),
+			overlap<Lanes>(f[rectangle_a_lower_y], f[rectangle_a_upper_y], lower[1], upper[1], o[3])));
+
+		// smallest overlap, the first two are along the axes of b, the last two along the axes of a
+		value_type best = o[0];
+		value_type basis[2]{ Lanes::set(1.f), Lanes::set(0.f) };
+		value_type m[6];
+		for (unsigned int i = 0; i < 6; ++i) {
+			m[i] = f[rectangle_t1 + i];
+		}
+		for (unsigned int i = 1; i < 4; ++i) {
+			typename Lanes::mask_type smaller = Lanes::less(Lanes::abs(o[i]), Lanes::abs(best));
+			best = Lanes::select(smaller, o[i], best);
+			basis[0] = Lanes::select(smaller, Lanes::set(i % 2 == 0 ? 1.f : 0.f), basis[0]);
+			basis[1] = Lanes::select(smaller, Lanes::set(i % 2 == 0 ? 0.f : 1.f), basis[1]);
+			for (unsigned int j = 0; j < 6; ++j) {
+				m[j] = Lanes::select(smaller, f[(i < 2 ? rectangle_t1 : rectangle_t0) + j], m[j]);
+			}
+		}
+
+		value_type v[2]{ Lanes::mul(basis[0], best), Lanes::mul(basis[1], best) };
+		value_type zero = Lanes::set(0.f);
+		Lanes::store(output + output_hit * stride, Lanes::select(hit, Lanes::set(1.f), zero));
+		for (unsigned int r = 0; r < 2; ++r) {
+			value_type mtv = Lanes::sub(transform_row<Lanes>(m[r * 3], m[r * 3 + 1], m[r * 3 + 2], v[0], v[1]), m[r * 3 + 2]);
+			Lanes::store(output + (output_mtv_x + r) * stride, Lanes::select(hit, mtv, zero));
+		}
+	}
+
+	/**
+		\brief test Lanes::width point-ellipse pairs, mirrors CollisionShape<2>::Ellipse::collides(const Point&)
+	*/
+	template <typename Lanes>
+	void point_ellipse_kernel(const float* lanes, mv::size_type stride, float* output)
+	{
+		using value_type = typename Lanes::value_type;
+		value_type f[point_ellipse_field_count];
+		for (unsigned int i = 0; i < point_ellipse_field_count; ++i) {
+			f[i] = Lanes::load(lanes + i * stride);
+		}
+
+		// point in unit circle space
+		value_type p[2];
+		for (unsigned int r = 0; r < 2; ++r) {
+			p[r] = transform_row<Lanes>(f[point_ellipse_ta + r * 3], f[point_ellipse_ta + r * 3 + 1], f[point_ellipse_ta + r * 3 + 2],
+				f[point_ellipse_x], f[point_ellipse_y]);
+		}
+		value_type sqrm = Lanes::add(Lanes::add(Lanes::set(0.f), Lanes::mul(p[0], p[0])), Lanes::mul(p[1], p[1]));
+		typename Lanes::mask_type hit = Lanes::less_equal(sqrm, Lanes::set(1.f));
+		value_type m = Lanes::sqrt(sqrm);
+		value_type q[2]{ Lanes::div(p[0], m), Lanes::div(p[1], m) }; // closest point on the circle
+
+		value_type zero = Lanes::set(0.f);
+		Lanes::store(output + output_hit * stride, Lanes::select(hit, Lanes::set(1.f), zero));
+		for (unsigned int r = 0; r < 2; ++r) {
+			const value_type* t = f + point_ellipse_t0 + r * 3;
+			value_type mtv = Lanes::sub(transform_row<Lanes>(t[0], t[1], t[2], p[0], p[1]), transform_row<Lanes>(t[0], t[1], t[2], q[0], q[1]));
+			Lanes::store(output + (output_mtv_x + r) * stride, Lanes::mul(Lanes::select(hit, mtv, zero), f[point_ellipse_sign]));
+		}
+	}
+
+	/**
+		\brief run kernel over all lanes
+	*/
+	void run_kernel(void (*kernel)(const float*, mv::size_type, float*), const float* lanes, float* output, mv::size_type stride)
+	{
+		for (mv::size_type i = 0; i < stride; i += KernelLanes::width) {
+			kernel(lanes + i, stride, output + i);
+		}
+	}
+}
+
+
+
+template <mv::uint dims>
+mv::size_type mv::CollisionBatch<dims>::add(
+	const shape_type& shape0, const placement_type& placement0, const shape_type& shape1, const placement_type& placement1)
+{
+	this->_pairs.push_back(Pair{ &shape0, &shape1, &placement0, &placement1, SupportHints{ 0, 0 } });
+	size_type pair = static_cast<size_type>(this->_pairs.size() - 1);
+	this->_group(pair);
+	return pair;
+}
+
+template <mv::uint dims>
+void mv::CollisionBatch<dims>::warm_start(size_type pair, const SupportHints& hints)
+{
+	this->_pairs.at(pair).hints = hints;
+}
+
+template <mv::uint dims>
+void mv::CollisionBatch<dims>::solve()
+{
+	this->_hits.assign(this->_pairs.size(), false);
+	this->_mtvs.assign(this->_pairs.size(), vector_type{});
+
+	this->_solve_kernels();
+
+	for (size_type pair : this->_generic_pairs) {
+		Pair& p = this->_pairs[pair];
+		this->_hits[pair] = p.shape0->collides(*p.shape1, *p.placement0, *p.placement1, this->_mtvs[pair], p.hints);
+	}
+}
+
+template <mv::uint dims>
+void mv::CollisionBatch<dims>::clear()
+{
+	this->_pairs.clear();
+	this->_rectangle_pairs.clear();
+	this->_point_ellipse_pairs.clear();
+	this->_generic_pairs.clear();
+	this->_hits.clear();
+	this->_mtvs.clear();
+}
+
+
+template <mv::uint dims>
+mv::size_type mv::CollisionBatch<dims>::size() const
+{
+	return static_cast<size_type>(this->_pairs.size());
+}
+
+template <mv::uint dims>
+bool mv::CollisionBatch<dims>::empty() const
+{
+	return this->_pairs.empty();
+}
+
+
+template <mv::uint dims>
+bool mv::CollisionBatch<dims>::hit(size_type pair) const
+{
+	return this->_hits.at(pair);
+}
+
+template <mv::uint dims>
+const typename mv::CollisionBatch<dims>::vector_type& mv::CollisionBatch<dims>::mtv(size_type pair) const
+{
+	return this->_mtvs.at(pair);
+}
+
+template <mv::uint dims>
+const mv::SupportHints& mv::CollisionBatch<dims>::hints(size_type pair) const
+{
+	return this->_pairs.at(pair).hints;
+}
+
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
+void mv::CollisionBatch<dims>::_group(size_type pair)
+{
+	using Type = typename shape_type::Type;
+	Type type0 = this->_pairs[pair].shape0->type();
+	Type type1 = this->_pairs[pair].shape1->type();
+	if (type0 == Type::rectangle && type1 == Type::rectangle) {
+		this->_rectangle_pairs.push_back(pair);
+	}
+	else if ((type0 == Type::ellipse && type1 == Type::point) || (type0 == Type::point && type1 == Type::ellipse)) {
+		this->_point_ellipse_pairs.push_back(pair);
+	}
+	else {
+		this->_generic_pairs.push_back(pair);
+	}
+}
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
+void mv::CollisionBatch<dims>::_group(size_type pair)
+{
+	this->_generic_pairs.push_back(pair);
+}
+
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
+void mv::CollisionBatch<dims>::_solve_kernels()
+{
+	if (!this->_rectangle_pairs.empty()) {
+		size_type stride = padded_lane_count(static_cast<size_type>(this->_rectangle_pairs.size()));
+		this->_lanes.assign(rectangle_field_count * stride, 0.f);
+		this->_output.assign(output_field_count * stride, 0.f);
+		for (size_type i = 0; i < this->_rectangle_pairs.size(); ++i) {
+			const Pair& p = this->_pairs[this->_rectangle_pairs[i]];
+			const typename shape_type::Rectangle& a = p.shape0->as_rectangle();
+			const typename shape_type::Rectangle& b = p.shape1->as_rectangle();
+			float* lane = this->_lanes.data() + i;
+			lane[rectangle_a_lower_x * stride] = a.lower_x();
+			lane[rectangle_a_lower_y * stride] = a.lower_y();
+			lane[rectangle_a_upper_x * stride] = a.upper_x();
+			lane[rectangle_a_upper_y * stride] = a.upper_y();
+			lane[rectangle_b_lower_x * stride] = b.lower_x();
+			lane[rectangle_b_lower_y * stride] = b.lower_y();
+			lane[rectangle_b_upper_x * stride] = b.upper_x();
+			lane[rectangle_b_upper_y * stride] = b.upper_y();
+			store_affine(lane + rectangle_ta * stride, stride, p.placement1->inverse * p.placement0->transform);
+			store_affine(lane + rectangle_tb * stride, stride, p.placement0->inverse * p.placement1->transform);
+			store_affine(lane + rectangle_t0 * stride, stride, p.placement0->transform);
+			store_affine(lane + rectangle_t1 * stride, stride, p.placement1->transform);
+		}
+		run_kernel(&rectangle_kernel<KernelLanes>, this->_lanes.data(), this->_output.data(), stride);
+		for (size_type i = 0; i < this->_rectangle_pairs.size(); ++i) {
+			size_type pair = this->_rectangle_pairs[i];
+			this->_hits[pair] = this->_output[output_hit * stride + i] != 0.f;
+			this->_mtvs[pair] = vector_type{ this->_output[output_mtv_x * stride + i], this->_output[output_mtv_y * stride + i] };
+		}
+	}
+
+	if (!this->_point_ellipse_pairs.empty()) {
+		size_type stride = padded_lane_count(static_cast<size_type>(this->_point_ellipse_pairs.size()));
+		this->_lanes.assign(point_ellipse_field_count * stride, 0.f);
+		this->_output.assign(output_field_count * stride, 0.f);
+		for (size_type i = 0; i < this->_point_ellipse_pairs.size(); ++i) {
+			const Pair& p = this->_pairs[this->_point_ellipse_pairs[i]];
+			bool point_first = p.shape0->type() == shape_type::Type::point;
+			const placement_type& ellipse_placement = point_first ? *p.placement1 : *p.placement0;
+			const placement_type& point_placement = point_first ? *p.placement0 : *p.placement1;
+			const typename shape_type::Point& point = (point_first ? p.shape0 : p.shape1)->as_point();
+			float* lane = this->_lanes.data() + i;
+			store_affine(lane + point_ellipse_ta * stride, stride, ellipse_placement.inverse * point_placement.transform);
+			lane[point_ellipse_x * stride] = point.p0.x();
+			lane[point_ellipse_y * stride] = point.p0.y();
+			store_affine(lane + point_ellipse_t0 * stride, stride, ellipse_placement.transform);
+			lane[point_ellipse_sign * stride] = point_first ? -1.f : 1.f;
+		}
+		run_kernel(&point_ellipse_kernel<KernelLanes>, this->_lanes.data(), this->_output.data(), stride);
+		for (size_type i = 0; i < this->_point_ellipse_pairs.size(); ++i) {
+			size_type pair = this->_point_ellipse_pairs[i];
+			this->_hits[pair] = this->_output[output_hit * stride + i] != 0.f;
+			this->_mtvs[pair] = vector_type{ this->_output[output_mtv_x * stride + i], this->_output[output_mtv_y * stride + i] };
+		}
+	}
+}
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
+void mv::CollisionBatch<dims>::_solve_kernels()
+{}
+
+
+
+
+template class mv::CollisionBatch<2>;
+template class mv::CollisionBatch<3>;
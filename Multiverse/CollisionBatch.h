@@ -0,0 +1,100 @@
+#pragma once
+#include "setup.h"
+
+#include <type_traits>	// enable_if
+#include <vector>
+
+#include "CollisionShape.h"
+
+namespace mv
+{
+	/**
+		\brief list of shape pairs tested together
+
+		Pairs are grouped by shape combination when added. Rectangle-rectangle and point-ellipse pairs are tested
+		by structure of arrays kernels, which use SSE when MV_SIMD is enabled; the scalar kernels perform the same
+		operations in the same order, so both give identical results, which in turn match CollisionShape::collides.
+		All other pairs go through CollisionShape::collides one at a time.
+		All buffers are kept between solves, so reusing a batch every tick does not allocate once it has grown.
+	*/
+	template <uint dims>
+	class CollisionBatch
+	{
+	public:
+		using shape_type = CollisionShape<dims>;
+		using placement_type = typename shape_type::Placement;
+		using vector_type = decltype(placement_type::lower);
+
+	private:
+		struct Pair
+		{
+			const shape_type* shape0;
+			const shape_type* shape1;
+			const placement_type* placement0;
+			const placement_type* placement1;
+			SupportHints hints;
+		};
+
+		std::vector<Pair> _pairs;
+		std::vector<size_type> _rectangle_pairs; // rectangle-rectangle pairs
+		std::vector<size_type> _point_ellipse_pairs; // point-ellipse and ellipse-point pairs
+		std::vector<size_type> _generic_pairs;
+		std::vector<float> _lanes; // kernel input, one array per field
+		std::vector<float> _output; // kernel output: hit, mtv x and mtv y arrays
+		std::vector<bool> _hits;
+		std::vector<vector_type> _mtvs;
+
+	public:
+		CollisionBatch() = default;
+
+		/**
+			\brief add pair of shapes to test
+			\returns index of the pair
+
+			The shapes and placements must stay alive and unchanged until the batch is solved.
+		*/
+		size_type add(const shape_type& shape0, const placement_type& placement0, const shape_type& shape1, const placement_type& placement1);
+		/**
+			\brief start the support searches of a pair at hints, such as the ones the same pair ended on in the last tick
+		*/
+		void warm_start(size_type pair, const SupportHints& hints);
+		/**
+			\brief test all pairs added since the last clear
+		*/
+		void solve();
+		/**
+			\brief remove all pairs and results
+		*/
+		void clear();
+
+		size_type size() const;
+		bool empty() const;
+
+		/**
+			\brief get result of a pair, only valid after solve
+		*/
+		bool hit(size_type pair) const;
+		/**
+			\brief get minimum translation vector of a pair, to be added to the first shape, only valid after solve
+		*/
+		const vector_type& mtv(size_type pair) const;
+		/**
+			\brief get support hints a pair ended on, only valid after solve
+		*/
+		const SupportHints& hints(size_type pair) const;
+
+	private:
+		template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
+		void _group(size_type pair);
+		template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
+		void _group(size_type pair);
+		template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
+		void _solve_kernels();
+		template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
+		void _solve_kernels();
+	};
+
+
+	using CollisionBatch2D = CollisionBatch<2>;
+	using CollisionBatch3D = CollisionBatch<3>;
+}
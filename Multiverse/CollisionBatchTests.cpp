@@ -0,0 +1,80 @@
+#include "MultiversePCH.h"
+#include <catch.hpp>
+#include "CollisionBatch.h"
+
+#include <vector>
+
+using namespace mv;
+
+TEST_CASE("Batched rectangle pairs match CollisionShape::collides", "CollisionBatch")
+{
+	CollisionShape<2> a{ CollisionShape<2>::Rectangle{ vec2f{ -1.f, -0.5f }, vec2f{ 1.f, 0.5f } } };
+	CollisionShape<2> b{ CollisionShape<2>::Rectangle{ vec2f{ 0.f, 0.f }, vec2f{ 1.5f, 2.f } } };
+	CollisionShape<2>::Placement t0{ a.place(mat3f::transform(vec2f{ 1.f, 2.f }, 0.3f, vec2f{ 1.f, 1.f })) };
+
+	// 7 pairs, so the last group of lanes is only partly filled
+	std::vector<CollisionShape<2>::Placement> placements;
+	for (unsigned int i = 0; i < 7; ++i) {
+		float offset = static_cast<float>(i) * 0.7f;
+		placements.push_back(b.place(mat3f::transform(vec2f{ offset, 1.5f + 0.2f * offset }, 0.25f * static_cast<float>(i), vec2f{ 1.f, 1.f })));
+	}
+
+	CollisionBatch<2> batch;
+	for (const CollisionShape<2>::Placement& t1 : placements) {
+		batch.add(a, t0, b, t1);
+	}
+	batch.solve();
+
+	bool any_hit = false, any_miss = false;
+	for (size_type i = 0; i < placements.size(); ++i) {
+		vec2f mtv;
+		bool hit = a.collides(b, t0, placements[i], mtv);
+		REQUIRE(batch.hit(i) == hit);
+		if (hit) {
+			REQUIRE(batch.mtv(i) == mtv);
+		}
+		any_hit |= hit;
+		any_miss |= !hit;
+	}
+	REQUIRE(any_hit);
+	REQUIRE(any_miss);
+}
+
+TEST_CASE("Batched point-ellipse pairs match CollisionShape::collides", "CollisionBatch")
+{
+	CollisionShape<2> point{ CollisionShape<2>::Point{ vec2f{ 0.f, 0.f } } };
+	CollisionShape<2> ellipse{ CollisionShape<2>::Ellipse{ vec2f{ 0.f, 0.f }, vec2f{ 2.f, 1.f } } };
+	CollisionShape<2>::Placement te{ ellipse.place(mat3f::transform(vec2f{ 3.f, -1.f }, 0.7f, vec2f{ 1.f, 1.f })) };
+
+	// 6 pairs in both orders, the point first negates the mtv
+	std::vector<CollisionShape<2>::Placement> placements;
+	for (unsigned int i = 0; i < 6; ++i) {
+		float offset = static_cast<float>(i) * 0.5f;
+		placements.push_back(point.place(mat3f::transform(vec2f{ 2.f + offset, -1.2f + 0.1f * offset }, 0.f, vec2f{ 1.f, 1.f })));
+	}
+
+	CollisionBatch<2> batch;
+	for (size_type i = 0; i < placements.size(); ++i) {
+		if (i % 2 == 0) {
+			batch.add(point, placements[i], ellipse, te);
+		}
+		else {
+			batch.add(ellipse, te, point, placements[i]);
+		}
+	}
+	batch.solve();
+
+	bool any_hit = false, any_miss = false;
+	for (size_type i = 0; i < placements.size(); ++i) {
+		vec2f mtv;
+		bool hit = i % 2 == 0 ? point.collides(ellipse, placements[i], te, mtv) : ellipse.collides(point, te, placements[i], mtv);
+		REQUIRE(batch.hit(i) == hit);
+		if (hit) {
+			REQUIRE(batch.mtv(i) == mtv);
+		}
+		any_hit |= hit;
+		any_miss |= !hit;
+	}
+	REQUIRE(any_hit);
+	REQUIRE(any_miss);
+}
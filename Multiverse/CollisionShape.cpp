@@ -4,8 +4,11 @@
 #include <algorithm>	// copy, min, max, minmax, min_element, minmax_element
 #include <cmath>	// abs, atan2, cos, sin, sqrt
 #include <limits>	// numeric_limits
+#include <new>	// placement new
 #include <utility>	// move, pair
 
+#include "Fixed.h"
+
 
 
 enum RotationDirection
@@ -31,6 +34,298 @@ bool overlap(float amin, float amax, float bmin, float bmax, float& overlap) {
 }
 
 
+namespace
+{
+	constexpr unsigned int gjk_max_iterations{ 32 };
+	constexpr unsigned int epa_max_vertices{ 32 };
+	constexpr float epa_tolerance{ 1e-4f };
+	constexpr float gjk_distance_tolerance{ 1e-6f }; // relative improvement below which the distance is final
+	constexpr unsigned int ccd_max_iterations{ 32 };
+	constexpr float ccd_tolerance{ 1e-3f }; // distance at which moving shapes are considered touching
+
+	/**
+		\brief transform world space direction to shape space, so support points can be found without transforming the shape
+	*/
+	mv::vec2f local_direction(const mv::CollisionShape<2>::Placement& t, const mv::vec2f& direction)
+	{
+		return mv::vec2f{
+			t.transform[0][0] * direction.x() + t.transform[1][0] * direction.y(),
+			t.transform[0][1] * direction.x() + t.transform[1][1] * direction.y() };
+	}
+
+	/**
+		\brief check whether a placement maps the unit circle onto a circle
+		\param sqr_radius squared radius of the circle
+	*/
+	bool circle_placement(const mv::mat3f& t, float& sqr_radius)
+	{
+		static const float tolerance{ 1e-5f };
+		float sqr_x{ t[0][0] * t[0][0] + t[1][0] * t[1][0] };
+		float sqr_y{ t[0][1] * t[0][1] + t[1][1] * t[1][1] };
+		float skew{ t[0][0] * t[0][1] + t[1][0] * t[1][1] };
+		sqr_radius = sqr_x;
+		return std::abs(sqr_x - sqr_y) <= tolerance * sqr_x && std::abs(skew) <= tolerance * sqr_x;
+	}
+
+	/**
+		\brief get perpendicular of v on the side of towards
+	*/
+	mv::vec2f perpendicular(const mv::vec2f& v, const mv::vec2f& towards)
+	{
+		mv::vec2f p{ -v.y(), v.x() };
+		return p.dot(towards) < 0.f ? -p : p;
+	}
+
+	/**
+		\brief get world space support point of a shape, polygons start their search at hint and update it
+	*/
+	template <typename Shape>
+	mv::vec2f hinted_support(const Shape& shape, const mv::CollisionShape<2>::Placement& t, const mv::vec2f& direction, unsigned int&)
+	{
+		return shape.support(t, direction);
+	}
+
+	mv::vec2f hinted_support(const mv::CollisionShape<2>::Convex& shape, const mv::CollisionShape<2>::Placement& t, const mv::vec2f& direction,
+		unsigned int& hint)
+	{
+		return shape.support(t, direction, hint);
+	}
+
+	/**
+		\brief get world space support point of any shape
+	*/
+	mv::vec2f shape_support(const mv::CollisionShape<2>& shape, const mv::CollisionShape<2>::Placement& t, const mv::vec2f& direction,
+		unsigned int& hint)
+	{
+		using Type = mv::CollisionShape<2>::Type;
+		switch (shape.type())
+		{
+		case Type::point:
+			return shape.as_point().support(t, direction);
+		case Type::line:
+			return shape.as_line().support(t, direction);
+		case Type::rectangle:
+			return shape.as_rectangle().support(t, direction);
+		case Type::ellipse:
+			return shape.as_ellipse().support(t, direction);
+		case Type::convex:
+			return shape.as_convex().support(t, direction, hint);
+		default:
+			return (t.lower + t.upper) * 0.5f;
+		}
+	}
+
+	mv::vec2f hinted_support(const mv::CollisionShape<2>& shape, const mv::CollisionShape<2>::Placement& t, const mv::vec2f& direction,
+		unsigned int& hint)
+	{
+		return shape_support(shape, t, direction, hint);
+	}
+
+	/**
+		\brief collide two convex shapes through their support functions
+
+		GJK decides whether the shapes overlap, EPA then expands the final simplex to find the minimum translation vector.
+		Both are capped at a fixed amount of iterations, so a pair never costs more than a bounded amount of support queries.
+	*/
+	template <typename ShapeA, typename ShapeB>
+	bool gjk_epa(const ShapeA& a, const mv::CollisionShape<2>::Placement& t0,
+		const ShapeB& b, const mv::CollisionShape<2>::Placement& t1, mv::vec2f& mtv, mv::SupportHints& hints)
+	{
+		using mv::vec2f;
+		// support vertices of large polygons are searched from the previous ones
+		auto support = [&a, &t0, &b, &t1, &hints](const vec2f& direction) {
+			return hinted_support(a, t0, direction, hints.vertex0) - hinted_support(b, t1, -direction, hints.vertex1);
+		};
+
+		mtv = vec2f{ 0.f, 0.f };
+		vec2f direction{ (t0.lower + t0.upper) - (t1.lower + t1.upper) };
+		if (direction.squared_magnitude() == 0.f) {
+			direction = vec2f{ 1.f, 0.f };
+		}
+		vec2f simplex[3]{ support(direction) };
+		unsigned int count{ 1 };
+		direction = -simplex[0];
+
+		bool enclosed{ false };
+		for (unsigned int i{ 0 }; i < gjk_max_iterations && !enclosed; ++i) {
+			if (direction.squared_magnitude() == 0.f) {
+				return true; // origin on the simplex, shapes touch
+			}
+			vec2f p{ support(direction) };
+			if (p.dot(direction) < 0.f) {
+				return false;
+			}
+			simplex[count++] = p;
+
+			if (count == 2) {
+				vec2f ab{ simplex[0] - simplex[1] };
+				vec2f ao{ -simplex[1] };
+				if (ab.dot(ao) > 0.f) {
+					direction = perpendicular(ab, ao);
+				}
+				else {
+					simplex[0] = simplex[1];
+					count = 1;
+					direction = ao;
+				}
+			}
+			else {
+				vec2f ab{ simplex[1] - simplex[2] };
+				vec2f ac{ simplex[0] - simplex[2] };
+				vec2f ao{ -simplex[2] };
+				vec2f ab_normal{ -perpendicular(ab, ac) };
+				vec2f ac_normal{ -perpendicular(ac, ab) };
+				if (ab_normal.dot(ao) > 0.f) { // origin outside ab, drop c
+					simplex[0] = simplex[1];
+					simplex[1] = simplex[2];
+					count = 2;
+					direction = ab_normal;
+				}
+				else if (ac_normal.dot(ao) > 0.f) { // origin outside ac, drop b
+					simplex[1] = simplex[2];
+					count = 2;
+					direction = ac_normal;
+				}
+				else {
+					enclosed = true;
+				}
+			}
+		}
+		if (!enclosed) {
+			return false;
+		}
+
+		// expand the simplex towards the boundary of the minkowski difference closest to the origin
+		vec2f polytope[epa_max_vertices]{ simplex[0], simplex[1], simplex[2] };
+		count = 3;
+		vec2f e1{ polytope[1] - polytope[0] };
+		vec2f e2{ polytope[2] - polytope[0] };
+		float winding{ e1.x() * e2.y() - e1.y() * e2.x() }; // positive if anticlockwise
+		if (winding == 0.f) {
+			return true; // flat simplex, origin on its edge
+		}
+		for (;;) {
+			unsigned int closest{ 0 };
+			float closest_distance{ std::numeric_limits<float>::infinity() };
+			vec2f closest_normal{ 0.f, 0.f };
+			for (unsigned int i{ 0 }; i < count; ++i) {
+				vec2f edge{ polytope[(i + 1) % count] - polytope[i] };
+				if (edge.squared_magnitude() == 0.f) {
+					continue;
+				}
+				vec2f normal{ (winding > 0.f ? vec2f{ edge.y(), -edge.x() } : vec2f{ -edge.y(), edge.x() }).normalise() }; // outward
+				float distance{ normal.dot(polytope[i]) };
+				if (distance < closest_distance) {
+					closest = i;
+					closest_distance = distance;
+					closest_normal = normal;
+				}
+			}
+
+			vec2f p{ support(closest_normal) };
+			if (p.dot(closest_normal) - closest_distance <= epa_tolerance || count == epa_max_vertices) {
+				mtv = closest_normal * -closest_distance;
+				return true;
+			}
+			for (unsigned int i{ count }; i > closest + 1; --i) {
+				polytope[i] = polytope[i - 1];
+			}
+			polytope[closest + 1] = p;
+			++count;
+		}
+	}
+
+	/**
+		\brief get closest point to the origin on segment ab
+		\param t receives the position of the point along the segment
+	*/
+	mv::vec2f closest_on_segment(const mv::vec2f& a, const mv::vec2f& b, float& t)
+	{
+		mv::vec2f ab{ b - a };
+		float sqr_length{ ab.squared_magnitude() };
+		t = sqr_length > 0.f ? std::min(std::max(-a.dot(ab) / sqr_length, 0.f), 1.f) : 0.f;
+		return a + ab * t;
+	}
+
+	/**
+		\brief get distance from the origin to a convex set given by its support function
+		\param closest receives the point of the set closest to the origin found
+		\returns lower bound of the distance, 0 if the set contains the origin
+
+		GJK distance: the simplex is reduced to the feature closest to the origin after every support query.
+		The closest point only approaches the set from outside, so the returned bound comes from the last support point instead.
+	*/
+	template <typename Support>
+	float gjk_distance(const Support& support, const mv::vec2f& initial_direction, mv::vec2f& closest)
+	{
+		using mv::vec2f;
+		vec2f simplex[3]{ support(initial_direction) };
+		unsigned int count{ 1 };
+		closest = simplex[0];
+		float lower_bound{ 0.f };
+		for (unsigned int i{ 0 }; i < gjk_max_iterations; ++i) {
+			float sqr_distance{ closest.squared_magnitude() };
+			if (sqr_distance == 0.f) {
+				return 0.f;
+			}
+			vec2f w{ support(-closest) };
+			lower_bound = std::max(lower_bound, closest.dot(w) / std::sqrt(sqr_distance)); // every point lies beyond the plane through w
+			if (sqr_distance - closest.dot(w) <= gjk_distance_tolerance * sqr_distance) {
+				break; // no point of the set is meaningfully closer
+			}
+			simplex[count++] = w;
+
+			float t;
+			if (count == 2) {
+				closest = closest_on_segment(simplex[0], simplex[1], t);
+				if (t == 0.f) {
+					count = 1;
+				}
+				else if (t == 1.f) {
+					simplex[0] = simplex[1];
+					count = 1;
+				}
+			}
+			else {
+				vec2f ab{ simplex[1] - simplex[0] };
+				vec2f bc{ simplex[2] - simplex[1] };
+				vec2f ca{ simplex[0] - simplex[2] };
+				float d0{ ab.x() * -simplex[0].y() - ab.y() * -simplex[0].x() };
+				float d1{ bc.x() * -simplex[1].y() - bc.y() * -simplex[1].x() };
+				float d2{ ca.x() * -simplex[2].y() - ca.y() * -simplex[2].x() };
+				if ((d0 >= 0.f && d1 >= 0.f && d2 >= 0.f) || (d0 <= 0.f && d1 <= 0.f && d2 <= 0.f)) {
+					closest = vec2f{ 0.f, 0.f };
+					return 0.f; // origin inside the triangle
+				}
+				// the closest feature contains the newest point
+				float t0, t1;
+				vec2f c0{ closest_on_segment(simplex[0], simplex[2], t0) };
+				vec2f c1{ closest_on_segment(simplex[1], simplex[2], t1) };
+				if (c0.squared_magnitude() <= c1.squared_magnitude()) {
+					closest = c0;
+					t = t0;
+				}
+				else {
+					closest = c1;
+					t = t1;
+					simplex[0] = simplex[1];
+				}
+				simplex[1] = simplex[2];
+				count = 2;
+				if (t == 0.f) {
+					count = 1;
+				}
+				else if (t == 1.f) {
+					simplex[0] = simplex[1];
+					count = 1;
+				}
+			}
+		}
+		return lower_bound;
+	}
+}
+
+
 
 
 mv::CollisionShape<2>::CollisionShape()
@@ -61,102 +356,47 @@ mv::CollisionShape<2>::CollisionShape(Convex&& x)
 	: _convex(std::move(x)), _type{ Type::convex }
 {}
 
+mv::CollisionShape<2>::CollisionShape(const Tilemap& m)
+	: _tilemap(m), _type{ Type::tilemap }
+{}
+
+mv::CollisionShape<2>::CollisionShape(Tilemap&& m)
+	: _tilemap(std::move(m)), _type{ Type::tilemap }
+{}
+
 mv::CollisionShape<2>::CollisionShape(const CollisionShape<2>& obj)
-	: _type{ obj._type }
+	: _type{ Type::none }
 {
-	switch (this->_type)
-	{
-	case Type::point:
-		this->_point = obj._point;
-		break;
-	case Type::line:
-		this->_line = obj._line;
-		break;
-	case Type::rectangle:
-		this->_rectangle = obj._rectangle;
-		break;
-	case Type::ellipse:
-		this->_ellipse = obj._ellipse;
-		break;
-	case Type::convex:
-		this->_convex = obj._convex;
-		break;
-	}
+	this->_construct(obj);
 }
 
 mv::CollisionShape<2>::CollisionShape(CollisionShape<2>&& obj) noexcept
-	: _type{ obj._type }
+	: _type{ Type::none }
 {
-	switch (this->_type)
-	{
-	case Type::point:
-		this->_point = std::move(obj._point);
-		break;
-	case Type::line:
-		this->_line = std::move(obj._line);
-		break;
-	case Type::rectangle:
-		this->_rectangle = std::move(obj._rectangle);
-		break;
-	case Type::ellipse:
-		this->_ellipse = std::move(obj._ellipse);
-		break;
-	case Type::convex:
-		this->_convex = std::move(obj._convex);
-		break;
-	}
+	this->_construct(std::move(obj));
 }
 
 
-mv::CollisionShape<2>::~CollisionShape() = default;
+mv::CollisionShape<2>::~CollisionShape()
+{
+	this->_destroy();
+}
 
 
 mv::CollisionShape<2>& mv::CollisionShape<2>::operator=(const CollisionShape<2>& obj)
 {
-	this->_type = obj._type;
-
-	switch (this->_type)
-	{
-	case Type::point:
-		this->_point = obj._point;
-		break;
-	case Type::line:
-		this->_line = obj._line;
-		break;
-	case Type::rectangle:
-		this->_rectangle = obj._rectangle;
-		break;
-	case Type::ellipse:
-		this->_ellipse = obj._ellipse;
-		break;
-	case Type::convex:
-		this->_convex = obj._convex;
-		break;
+	if (this != &obj) {
+		this->_destroy();
+		this->_construct(obj);
 	}
 	return *this;
 }
 
 mv::CollisionShape<2>& mv::CollisionShape<2>::operator=(CollisionShape<2>&& obj) noexcept
 {
-	this->_type = obj._type;
-
-	switch (this->_type)
-	{
-	case Type::point:
-		this->_point = std::move(obj._point);
-		break;
-	case Type::line:
-		this->_line = std::move(obj._line);
-		break;
-	case Type::rectangle:
-		this->_rectangle = std::move(obj._rectangle);
-		break;
-	case Type::ellipse:
-		this->_ellipse = std::move(obj._ellipse);
-		break;
-	case Type::convex:
-		this->_convex = std::move(obj._convex);
-		break;
+	if (this != &obj) {
+		this->_destroy();
+		this->_construct(std::move(obj));
 	}
 	return *this;
 }
@@ -164,6 +404,17 @@ mv::CollisionShape<2>& mv::CollisionShape<2>::operator=(CollisionShape<2>&& obj)
 
 
 bool mv::CollisionShape<2>::collides(const CollisionShape& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+{
+	return this->collides(other, this->place(t0), other.place(t1), mtv);
+}
+
+bool mv::CollisionShape<2>::collides(const CollisionShape& other, const mat3f& t0, const mat3f& t1) const
+{
+	vec2f mtvDummy;
+	return this->collides(other, t0, t1, mtvDummy);
+}
+
+bool mv::CollisionShape<2>::collides(const CollisionShape& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
 	switch (this->_type)
 	{
@@ -217,6 +468,8 @@ bool mv::CollisionShape<2>::collides(const CollisionShape& other, const mat3f& t
 		case Type::convex:
 			return this->_convex.collides(other._convex, t0, t1, mtv);
 		} break;
+	case Type::tilemap:
+		return this->_tilemap.collides(other, t0, t1, mtv);
 	case Type::none:
 		mtv = vec2f{ 0.f, 0.f };
 		return false;
@@ -227,10 +480,174 @@ bool mv::CollisionShape<2>::collides(const CollisionShape& other, const mat3f& t
 	return retval;
 }
 
-bool mv::CollisionShape<2>::collides(const CollisionShape& other, const mat3f& t0, const mat3f& t1) const
+bool mv::CollisionShape<2>::collides(const CollisionShape& other, const Placement& t0, const Placement& t1, vec2f& mtv, SupportHints& hints) const
 {
-	vec2f mtvDummy;
-	return this->collides(other, t0, t1, mtvDummy);
+	// convex polygons are the only shapes that search for their support points, all other pairs ignore the hints
+	if (this->_type == Type::convex && other._type != Type::tilemap && other._type != Type::none) {
+		return gjk_epa(this->_convex, t0, other, t1, mtv, hints);
+	}
+	if (other._type == Type::convex && this->_type != Type::tilemap && this->_type != Type::none) {
+		SupportHints swapped{ hints.vertex1, hints.vertex0 };
+		bool retval{ gjk_epa(other._convex, t1, *this, t0, mtv, swapped) };
+		hints = SupportHints{ swapped.vertex1, swapped.vertex0 };
+		mtv *= -1;
+		return retval;
+	}
+	return this->collides(other, t0, t1, mtv);
+}
+
+
+bool mv::CollisionShape<2>::time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+	const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal) const
+{
+	SupportHints hints{ 0, 0 };
+	return this->time_of_impact(other, t0, displacement0, t1, displacement1, toi, normal, hints);
+}
+
+bool mv::CollisionShape<2>::time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+	const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal, SupportHints& hints) const
+{
+	if (this->_type == Type::none || other._type == Type::none) {
+		return false;
+	}
+	if (this->_type == Type::tilemap) {
+		return this->_tilemap.time_of_impact(other, t0, displacement0, t1, displacement1, toi, normal);
+	}
+	if (other._type == Type::tilemap) {
+		bool retval{ other._tilemap.time_of_impact(*this, t1, displacement1, t0, displacement0, toi, normal) };
+		normal *= -1;
+		return retval;
+	}
+
+	// move this shape relative to other, which then stays in place
+	vec2f displacement{ displacement0 - displacement1 };
+	vec2f initial_direction{ (t0.lower + t0.upper) - (t1.lower + t1.upper) };
+	if (initial_direction.squared_magnitude() == 0.f) {
+		initial_direction = vec2f{ 1.f, 0.f };
+	}
+	float t{ 0.f };
+	for (unsigned int i{ 0 }; i < ccd_max_iterations; ++i) {
+		auto support = [this, &other, &t0, &t1, &displacement, t, &hints](const vec2f& direction) {
+			return shape_support(*this, t0, direction, hints.vertex0) + displacement * t - shape_support(other, t1, -direction, hints.vertex1);
+		};
+		vec2f closest;
+		float distance{ gjk_distance(support, initial_direction, closest) };
+		if (distance == 0.f && i == 0) {
+			return false; // already overlapping, left to the discrete collision
+		}
+		vec2f direction{ distance > 0.f ? closest / distance : normal };
+		float approach{ -displacement.dot(direction) }; // rate at which the distance closes
+		if (distance <= ccd_tolerance) {
+			if (i == 0 && approach <= 0.f) {
+				return false; // touching but moving apart
+			}
+			toi = t;
+			normal = direction;
+			return true;
+		}
+		if (approach <= 0.f) {
+			return false;
+		}
+		t += distance / approach;
+		if (t > 1.f) {
+			return false;
+		}
+		normal = direction;
+		initial_direction = closest;
+	}
+	toi = t; // never past the first touch, so stopping early is still safe
+	return true;
+}
+
+
+mv::CollisionShape<2>::Placement mv::CollisionShape<2>::place(const mat3f& t) const
+{
+	return this->place(t, t.affine_inverse());
+}
+
+mv::CollisionShape<2>::Placement mv::CollisionShape<2>::place(const mat3f& t, const mat3f& inverse) const
+{
+	Placement placement;
+	switch (this->_type)
+	{
+	case Type::rectangle:
+		placement.transform = this->_rectangle.apply_rotation(t);
+		placement.inverse = this->_rectangle.apply_inverse_rotation(inverse);
+		break;
+	case Type::ellipse:
+		placement.transform = this->_ellipse.apply_transform(t);
+		placement.inverse = this->_ellipse.apply_inverse_transform(inverse);
+		break;
+	default:
+		placement.transform = t;
+		placement.inverse = inverse;
+		break;
+	}
+
+	placement.lower = vec2f{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+	placement.upper = vec2f{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+	auto include = [&placement](const vec2f& local) {
+		vec2f v{ placement.transform * vec3f{ local, 1.f } };
+		placement.lower.x() = std::min(placement.lower.x(), v.x());
+		placement.lower.y() = std::min(placement.lower.y(), v.y());
+		placement.upper.x() = std::max(placement.upper.x(), v.x());
+		placement.upper.y() = std::max(placement.upper.y(), v.y());
+	};
+	switch (this->_type)
+	{
+	case Type::point:
+		include(this->_point.p0);
+		break;
+	case Type::line:
+		include(this->_line.p0);
+		include(this->_line.p1);
+		break;
+	case Type::rectangle:
+		include(this->_rectangle.lower_xy());
+		include(vec2f{ this->_rectangle.upper_x(), this->_rectangle.lower_y() });
+		include(this->_rectangle.upper_xy());
+		include(vec2f{ this->_rectangle.lower_x(), this->_rectangle.upper_y() });
+		break;
+	case Type::ellipse: {
+		// half extents of the transformed unit circle
+		const mat3f& m{ placement.transform };
+		vec2f extent{ std::sqrt(m[0][0] * m[0][0] + m[0][1] * m[0][1]), std::sqrt(m[1][0] * m[1][0] + m[1][1] * m[1][1]) };
+		placement.lower = vec2f{ m[0][2], m[1][2] } - extent;
+		placement.upper = vec2f{ m[0][2], m[1][2] } + extent;
+	} break;
+	case Type::convex:
+		for (unsigned int i{ 0 }; i < this->_convex.size(); ++i) {
+			include(this->_convex[i]);
+		}
+		break;
+	case Type::tilemap: {
+		vec2f size{ static_cast<float>(this->_tilemap.width()) * this->_tilemap.tile_size().x(),
+			static_cast<float>(this->_tilemap.height()) * this->_tilemap.tile_size().y() };
+		include(vec2f{ 0.f, 0.f });
+		include(vec2f{ size.x(), 0.f });
+		include(size);
+		include(vec2f{ 0.f, size.y() });
+	} break;
+	}
+	return placement;
+}
+
+
+bool mv::CollisionShape<2>::Placement::overlaps(const Placement& other) const
+{
+	return this->lower.x() <= other.upper.x() && other.lower.x() <= this->upper.x() &&
+		this->lower.y() <= other.upper.y() && other.lower.y() <= this->upper.y();
+}
+
+mv::CollisionShape<2>::Placement mv::CollisionShape<2>::Placement::translated(const vec2f& offset) const
+{
+	Placement placement{ *this };
+	placement.transform[0][2] += offset.x();
+	placement.transform[1][2] += offset.y();
+	placement.inverse = placement.transform.affine_inverse();
+	placement.lower += offset;
+	placement.upper += offset;
+	return placement;
 }
 
 
@@ -260,6 +677,11 @@ const mv::CollisionShape<2>::Convex& mv::CollisionShape<2>::as_convex() const
 	return this->_convex;
 }
 
+const mv::CollisionShape<2>::Tilemap& mv::CollisionShape<2>::as_tilemap() const
+{
+	return this->_tilemap;
+}
+
 
 mv::CollisionShape<2>::Type mv::CollisionShape<2>::type() const
 {
@@ -267,29 +689,99 @@ mv::CollisionShape<2>::Type mv::CollisionShape<2>::type() const
 }
 
 
+void mv::CollisionShape<2>::_construct(const CollisionShape<2>& obj)
+{
+	switch (obj._type)
+	{
+	case Type::point:
+		new (&this->_point) Point(obj._point);
+		break;
+	case Type::line:
+		new (&this->_line) Line(obj._line);
+		break;
+	case Type::rectangle:
+		new (&this->_rectangle) Rectangle(obj._rectangle);
+		break;
+	case Type::ellipse:
+		new (&this->_ellipse) Ellipse(obj._ellipse);
+		break;
+	case Type::convex:
+		new (&this->_convex) Convex(obj._convex);
+		break;
+	case Type::tilemap:
+		new (&this->_tilemap) Tilemap(obj._tilemap);
+		break;
+	}
+	this->_type = obj._type;
+}
+
+void mv::CollisionShape<2>::_construct(CollisionShape<2>&& obj)
+{
+	switch (obj._type)
+	{
+	case Type::point:
+		new (&this->_point) Point(std::move(obj._point));
+		break;
+	case Type::line:
+		new (&this->_line) Line(std::move(obj._line));
+		break;
+	case Type::rectangle:
+		new (&this->_rectangle) Rectangle(std::move(obj._rectangle));
+		break;
+	case Type::ellipse:
+		new (&this->_ellipse) Ellipse(std::move(obj._ellipse));
+		break;
+	case Type::convex:
+		new (&this->_convex) Convex(std::move(obj._convex));
+		break;
+	case Type::tilemap:
+		new (&this->_tilemap) Tilemap(std::move(obj._tilemap));
+		break;
+	}
+	this->_type = obj._type;
+}
+
+void mv::CollisionShape<2>::_destroy()
+{
+	if (this->_type == Type::convex) { // the other shapes are trivially destructible
+		this->_convex.~Convex();
+	}
+	else if (this->_type == Type::tilemap) {
+		this->_tilemap.~Tilemap();
+	}
+	this->_type = Type::none;
+}
+
+
 
 
-bool mv::CollisionShape<2>::Point::collides(const Point&, const mat3f&, const mat3f&, vec2f& mtv) const
+bool mv::CollisionShape<2>::Point::collides(const Point&, const Placement&, const Placement&, vec2f& mtv) const
 {
 	mtv = vec2f{ 0.f, 0.f };
 	return false;
 }
 
 
+mv::vec2f mv::CollisionShape<2>::Point::support(const Placement& t, const vec2f&) const
+{
+	return t.transform * vec3f{ this->p0, 1.f };
+}
+
+
 
 
-bool mv::CollisionShape<2>::Line::collides(const Point&, const mat3f&, const mat3f&, vec2f& mtv) const
+bool mv::CollisionShape<2>::Line::collides(const Point&, const Placement&, const Placement&, vec2f& mtv) const
 {
 	mtv = vec2f{ 0.f, 0.f };
 	return false;
 }
 
-bool mv::CollisionShape<2>::Line::collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Line::collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	vec2f a0{ t0 * vec3f{ this->p0, 1.f } };
-	vec2f a1{ t0 * vec3f{ this->p1, 1.f } };
-	vec2f b0{ t1 * vec3f{ other.p0, 1.f } };
-	vec2f b1{ t1 * vec3f{ other.p1, 1.f } };
+	vec2f a0{ t0.transform * vec3f{ this->p0, 1.f } };
+	vec2f a1{ t0.transform * vec3f{ this->p1, 1.f } };
+	vec2f b0{ t1.transform * vec3f{ other.p0, 1.f } };
+	vec2f b1{ t1.transform * vec3f{ other.p1, 1.f } };
 	float oA, oB;
 
 	vec2f aAxis{ (a1 - a0).cross().normalise() };
@@ -313,18 +805,26 @@ bool mv::CollisionShape<2>::Line::collides(const Line& other, const mat3f& t0, c
 }
 
 
+mv::vec2f mv::CollisionShape<2>::Line::support(const Placement& t, const vec2f& direction) const
+{
+	vec2f a{ t.transform * vec3f{ this->p0, 1.f } };
+	vec2f b{ t.transform * vec3f{ this->p1, 1.f } };
+	return a.dot(direction) >= b.dot(direction) ? a : b;
+}
+
+
 
 
 mv::CollisionShape<2>::Rectangle::Rectangle(const vec2f& lower_xy, const vec2f& upper_xy, float angle)
-	: _lower_xy{ lower_xy }, _upper_xy{ upper_xy }, _cos_a{ std::cos(angle) }, _sin_a{ std::sin(angle) }
+	: _lower_xy{ lower_xy }, _upper_xy{ upper_xy }, _cos_a{ angle_cos(angle) }, _sin_a{ angle_sin(angle) }
 {}
 
 
 
-bool mv::CollisionShape<2>::Rectangle::collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Rectangle::collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	mat3f t0r{ this->apply_rotation(t0) };
-	mat3f t{ t0r.inverse() * t1 };
+	const mat3f& t0r{ t0.transform };
+	mat3f t{ t0.inverse * t1.transform };
 	vec2f p{ t * vec3f{ other.p0, 1.f } };
 
 	float o[2];
@@ -339,10 +839,10 @@ bool mv::CollisionShape<2>::Rectangle::collides(const Point& other, const mat3f&
 	return true;
 }
 
-bool mv::CollisionShape<2>::Rectangle::collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Rectangle::collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	mat3f t0r{ this->apply_rotation(t0) };
-	mat3f ta{ t0r.inverse() * t1 };
+	const mat3f& t0r{ t0.transform };
+	mat3f ta{ t0.inverse * t1.transform };
 	vec2f b0{ ta * vec3f{ other.p0, 1.f } };
 	vec2f b1{ ta * vec3f{ other.p1, 1.f } };
 
@@ -357,8 +857,8 @@ bool mv::CollisionShape<2>::Rectangle::collides(const Line& other, const mat3f&
 
 	// line axis
 	vec2f a[4]{ this->lower_xy(), vec2f{ this->upper_x(), this->lower_y() }, this->upper_xy(), vec2f{ this->lower_x(), this->upper_y() } };
-	b0 = t1 * vec3f{ other.p0, 1.f };
-	b1 = t1 * vec3f{ other.p1, 1.f };
+	b0 = t1.transform * vec3f{ other.p0, 1.f };
+	b1 = t1.transform * vec3f{ other.p1, 1.f };
 	vec2f line_axis{ (b1 - b0).cross().normalise() };
 	float bp{ line_axis.dot(b0) }; // normal axis projection is the same for b0 and b1, like the y axis projection of a horizontal line
 	float ap[4];
@@ -384,13 +884,13 @@ bool mv::CollisionShape<2>::Rectangle::collides(const Line& other, const mat3f&
 	return true;
 }
 
-bool mv::CollisionShape<2>::Rectangle::collides(const Rectangle& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Rectangle::collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	mat3f t0r{ this->apply_rotation(t0) };
-	mat3f t1r{ other.apply_rotation(t1) };
+	const mat3f& t0r{ t0.transform };
+	const mat3f& t1r{ t1.transform };
 	float o[4];
 
-	mat3f ta{ t1r.inverse() * t0r };
+	mat3f ta{ t1.inverse * t0r };
 	vec2f pa[4]{ this->lower_xy(), vec2f{ this->upper_x(), this->lower_y() },
 		this->upper_xy(), vec2f{ this->lower_x(), this->upper_y() } };
 	vec2f mina{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
@@ -408,7 +908,7 @@ bool mv::CollisionShape<2>::Rectangle::collides(const Rectangle& other, const ma
 		return false;
 	}
 
-	mat3f tb{ t0r.inverse() * t1r };
+	mat3f tb{ t0.inverse * t1r };
 	vec2f pb[4]{ other.lower_xy(), vec2f{ other.upper_x(), other.lower_y() },
 		other.upper_xy(), vec2f{ other.lower_x(), other.upper_y() } };
 	vec2f minb{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
@@ -433,6 +933,14 @@ bool mv::CollisionShape<2>::Rectangle::collides(const Rectangle& other, const ma
 }
 
 
+mv::vec2f mv::CollisionShape<2>::Rectangle::support(const Placement& t, const vec2f& direction) const
+{
+	vec2f local{ local_direction(t, direction) };
+	vec2f corner{ local.x() >= 0.f ? this->upper_x() : this->lower_x(), local.y() >= 0.f ? this->upper_y() : this->lower_y() };
+	return t.transform * vec3f{ corner, 1.f };
+}
+
+
 
 const mv::vec2f& mv::CollisionShape<2>::Rectangle::lower_xy() const
 {
@@ -480,19 +988,29 @@ mv::mat3f mv::CollisionShape<2>::Rectangle::apply_rotation(const mat3f& m) const
 	};
 }
 
+mv::mat3f mv::CollisionShape<2>::Rectangle::apply_inverse_rotation(const mat3f& m) const
+{
+	// (m R)^-1 = R^T m^-1
+	return mat3f{
+		this->_cos_a * m[0][0] + this->_sin_a * m[1][0], this->_cos_a * m[0][1] + this->_sin_a * m[1][1], this->_cos_a * m[0][2] + this->_sin_a * m[1][2],
+		-this->_sin_a * m[0][0] + this->_cos_a * m[1][0], -this->_sin_a * m[0][1] + this->_cos_a * m[1][1], -this->_sin_a * m[0][2] + this->_cos_a * m[1][2],
+		0.f, 0.f, 1.f
+	};
+}
+
 
 
 
 mv::CollisionShape<2>::Ellipse::Ellipse(const vec2f& centre, const vec2f& radii, float angle)
-	: _centre{ centre }, _radii{ radii }, _cos_a{ std::cos(angle) }, _sin_a{ std::sin(angle) }
+	: _centre{ centre }, _radii{ radii }, _cos_a{ angle_cos(angle) }, _sin_a{ angle_sin(angle) }
 {}
 
 
 
-bool mv::CollisionShape<2>::Ellipse::collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Ellipse::collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	mat3f t0t{ this->apply_transform(t0) };
-	mat3f ta{ t0t.inverse() * t1 };
+	const mat3f& t0t{ t0.transform };
+	mat3f ta{ t0.inverse * t1.transform };
 	vec2f p0{ ta * vec3f{ other.p0, 1.f } };
 
 	float sqrm{ p0.squared_magnitude() };
@@ -501,10 +1019,10 @@ bool mv::CollisionShape<2>::Ellipse::collides(const Point& other, const mat3f& t
 	return retval;
 }
 
-bool mv::CollisionShape<2>::Ellipse::collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Ellipse::collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	mat3f t0t{ this->apply_transform(t0) };
-	mat3f ta{ t0t.inverse() * t1 };
+	const mat3f& t0t{ t0.transform };
+	mat3f ta{ t0.inverse * t1.transform };
 	vec2f p0{ ta * vec3f{ other.p0, 1.f } };
 	vec2f p1{ ta * vec3f{ other.p1, 1.f } };
 	float lineMag{ static_cast<float>((p1 - p0).magnitude()) };
@@ -518,12 +1036,12 @@ bool mv::CollisionShape<2>::Ellipse::collides(const Line& other, const mat3f& t0
 	return retval;
 }
 
-bool mv::CollisionShape<2>::Ellipse::collides(const Rectangle& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Ellipse::collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
 	static const float min_sqr_mag{ 1.f / 65536.f }; // distance small enough to be considered zero
 
-	mat3f t0t{ this->apply_transform(t0) };
-	mat3f ta{ t0t.inverse() * other.apply_rotation(t1) };
+	const mat3f& t0t{ t0.transform };
+	mat3f ta{ t0.inverse * t1.transform };
 	vec2f p[4]{ { ta * vec3f{ other.lower_xy(), 1.f } },
 		{ ta * vec3f{ other.upper_x(), other.lower_y(), 1.f } },
 		{ ta * vec3f{ other.upper_xy(), 1.f } },
@@ -571,38 +1089,99 @@ bool mv::CollisionShape<2>::Ellipse::collides(const Rectangle& other, const mat3
 	}
 }
 
-bool mv::CollisionShape<2>::Ellipse::collides(const Ellipse& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const
+bool mv::CollisionShape<2>::Ellipse::collides(const Ellipse&, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	static const unsigned int precision{ 8u };
-	static const float min_sqr_mag{ 1.f / 65536.f }; // distance small enough to be considered zero
+	static const unsigned int max_iterations{ 16u };
+	static const float tolerance{ 1e-6f };
+
+	const mat3f& t0t{ t0.transform };
+	const mat3f& t1t{ t1.transform };
+
+	// circles, the placement maps the unit circle onto them without stretching
+	float sqr_radius0, sqr_radius1;
+	if (circle_placement(t0t, sqr_radius0) && circle_placement(t1t, sqr_radius1)) {
+		vec2f d{ t0t[0][2] - t1t[0][2], t0t[1][2] - t1t[1][2] };
+		float radii{ std::sqrt(sqr_radius0) + std::sqrt(sqr_radius1) };
+		float sqr_distance{ d.squared_magnitude() };
+		if (sqr_distance > radii * radii) {
+			mtv = vec2f{ 0.f, 0.f };
+			return false;
+		}
+		float distance{ std::sqrt(sqr_distance) };
+		mtv = distance > 0.f ? d * ((radii - distance) / distance) : vec2f{ radii, 0.f };
+		return true;
+	}
 
-	mat3f t0t{ this->apply_transform(t0) };
-	mat3f t1t{ other.apply_transform(t1) };
-	mat3f ta{ t1t.inverse() * t0t };
-	mat3f tb{ t0t.inverse() * t1t };
+	// in the unit circle space of a, find the point p = c + M u (|u| = 1) of ellipse b closest to the origin
+	mat3f tb{ t0.inverse * t1t };
+	vec2f c{ tb[0][2], tb[1][2] };
+	float m00{ tb[0][0] }, m01{ tb[0][1] }, m10{ tb[1][0] }, m11{ tb[1][1] };
+
+	// stationary points satisfy (S - l I) u = -g with S = M^T M and g = M^T c, solved in the eigenbasis of S
+	float s00{ m00 * m00 + m10 * m10 };
+	float s01{ m00 * m01 + m10 * m11 };
+	float s11{ m01 * m01 + m11 * m11 };
+	float half_trace{ (s00 + s11) * 0.5f };
+	float half_gap{ std::sqrt((s00 - s11) * (s00 - s11) * 0.25f + s01 * s01) };
+	float s[2]{ half_trace + half_gap, half_trace - half_gap }; // eigenvalues, s[0] >= s[1]
+	vec2f v0{ s00 >= s11 ? vec2f{ s[0] - s11, s01 } : vec2f{ s01, s[0] - s00 } }; // eigenvector of s[0]
+	float v0_sqrm{ v0.squared_magnitude() };
+	v0 = v0_sqrm > 0.f ? v0 / std::sqrt(v0_sqrm) : vec2f{ 1.f, 0.f };
+	vec2f v1{ -v0.y(), v0.x() };
+
+	vec2f g{ m00 * c.x() + m10 * c.y(), m01 * c.x() + m11 * c.y() };
+	float gv[2]{ g.dot(v0), g.dot(v1) };
+	float g_mag{ std::sqrt(gv[0] * gv[0] + gv[1] * gv[1]) };
+
+	float u[2];
+	float axis{ s[0] > s[1] ? -gv[0] / (s[0] - s[1]) : 0.f };
+	if (g_mag == 0.f) { // concentric
+		u[0] = 0.f;
+		u[1] = 1.f;
+	}
+	else if (!(s[0] > s[1])) { // b is a circle in the unit space of a, its closest point faces the origin
+		u[0] = -gv[0] / g_mag;
+		u[1] = -gv[1] / g_mag;
+	}
+	else if (std::abs(gv[1]) <= tolerance * g_mag && std::abs(axis) <= 1.f) { // c on the major axis, closest point off axis
+		u[0] = axis;
+		u[1] = std::sqrt(1.f - axis * axis);
+	}
+	else {
+		// the minimum has the multiplier l < s[1] where sum((g_j / (s_j - l))^2) = 1, that sum is convex and increasing in l,
+		// so newton started above the root (where the sum is at least 1) converges monotonically from the right
+		float l{ s[1] - std::abs(gv[1]) };
+		if (s[0] - std::abs(gv[0]) < l) {
+			l = s[0] - std::abs(gv[0]);
+		}
+		for (unsigned int i{ 0u }; i < max_iterations; ++i) {
+			float h{ -1.f };
+			float dh{ 0.f };
+			for (unsigned int j{ 0u }; j < 2u; ++j) {
+				float r{ gv[j] / (s[j] - l) };
+				h += r * r;
+				dh += 2.f * r * r / (s[j] - l);
+			}
+			if (h <= tolerance || dh == 0.f) {
+				break;
+			}
+			l -= h / dh;
+		}
+		u[0] = -gv[0] / (s[0] - l);
+		u[1] = -gv[1] / (s[1] - l);
+		float u_mag{ std::sqrt(u[0] * u[0] + u[1] * u[1]) }; // keep p on the ellipse if the iteration cap was hit
+		u[0] /= u_mag;
+		u[1] /= u_mag;
+	}
+	vec2f uv{ v0 * u[0] + v1 * u[1] };
+	vec2f p{ c.x() + m00 * uv.x() + m01 * uv.y(), c.y() + m10 * uv.x() + m11 * uv.y() };
+	float sqrm{ p.squared_magnitude() };
 
 	// check if center of a is inside ellipse b
-	bool a_in_b{ static_cast<vec2f>(ta * vec3f{ this->centre(), 1.f }).squared_magnitude() < 1.f };
-
-	float angle{ 0.f };
-	float delta_a{ static_cast<float>(2. * pi / 3.) };
-	vec2f p[3]{ vec2f{}, static_cast<vec2f>(tb * vec3f{ 1.f, 0.f, 1.f }), vec2f{} };
-	float sqrms[3]{ 0.f, p[1].squared_magnitude(), 0.f };
-
-	for (unsigned int i{ 0u }; i < precision; ++i, delta_a /= 2.f) {
-		p[0] = static_cast<vec2f>(tb * vec3f{ std::cos(angle - delta_a), std::sin(angle - delta_a), 1.f });
-		p[2] = static_cast<vec2f>(tb * vec3f{ std::cos(angle + delta_a), std::sin(angle + delta_a), 1.f });
-		sqrms[0] = p[0].squared_magnitude();
-		sqrms[2] = p[2].squared_magnitude();
-
-		std::ptrdiff_t closest{ std::min_element(sqrms, sqrms + 3) - sqrms };
-		p[1] = p[closest];
-		sqrms[1] = sqrms[closest];
-		angle += (closest - 1) * delta_a;
-	}
+	bool a_in_b{ static_cast<vec2f>(t1.inverse * t0t.get_column(2)).squared_magnitude() < 1.f };
 
-	if (a_in_b || sqrms[1] <= 1.f) {
-		mtv = ((a_in_b ? -p[1] : p[1]) / std::sqrt(sqrms[1])) - p[1];
+	if (a_in_b || sqrm <= 1.f) {
+		mtv = ((a_in_b ? -p : p) / std::sqrt(sqrm)) - p;
 		mtv = t0t.get_column(2) - t0t * vec3f{ mtv, 1.f };
 		return true;
 	}
@@ -613,6 +1192,17 @@ bool mv::CollisionShape<2>::Ellipse::collides(const Ellipse& other, const mat3f&
 }
 
 
+mv::vec2f mv::CollisionShape<2>::Ellipse::support(const Placement& t, const vec2f& direction) const
+{
+	vec2f local{ local_direction(t, direction) }; // the placement maps the unit circle onto the ellipse
+	float magnitude{ static_cast<float>(local.magnitude()) };
+	if (magnitude == 0.f) {
+		return vec2f{ t.transform[0][2], t.transform[1][2] };
+	}
+	return t.transform * vec3f{ local / magnitude, 1.f };
+}
+
+
 
 const mv::vec2f& mv::CollisionShape<2>::Ellipse::centre() const
 {
@@ -649,50 +1239,67 @@ mv::mat3f mv::CollisionShape<2>::Ellipse::apply_transform(const mat3f& m) const
 	};
 }
 
+mv::mat3f mv::CollisionShape<2>::Ellipse::apply_inverse_transform(const mat3f& m) const
+{
+	// (m C R S)^-1 = S^-1 R^T C^-1 m^-1, with C the translation to the centre and S the radii
+	vec2f row0{ this->_cos_a / this->_radii.x(), this->_sin_a / this->_radii.x() };
+	vec2f row1{ -this->_sin_a / this->_radii.y(), this->_cos_a / this->_radii.y() };
+	return mat3f{
+		row0.x(), row0.y(), -row0.dot(this->_centre),
+		row1.x(), row1.y(), -row1.dot(this->_centre),
+		0.f, 0.f, 1.f
+	} * m;
+}
+
 
 
 
 mv::CollisionShape<2>::Convex::Convex()
-	: _vertices{ nullptr }, _vertex_count{ 0 }
+	: _inline_vertices{}, _vertices{ _inline_vertices }, _vertex_count{ 0 }
 {}
 
 mv::CollisionShape<2>::Convex::Convex(std::initializer_list<vec2f> il)
-	: _vertices{ new vec2f[il.size()]{} }, _vertex_count{ static_cast<unsigned int>(il.size()) }
+	: _inline_vertices{}, _vertices{ nullptr }, _vertex_count{ 0 }
 {
+	this->_allocate(static_cast<unsigned int>(il.size()));
 	std::copy(il.begin(), il.end(), this->_vertices);
 }
 
 mv::CollisionShape<2>::Convex::Convex(const Convex& obj)
-	: _vertices{ new vec2f[obj._vertex_count]{} }, _vertex_count{ obj._vertex_count }
+	: _inline_vertices{}, _vertices{ nullptr }, _vertex_count{ 0 }
 {
+	this->_allocate(obj._vertex_count);
 	std::copy(obj._vertices, obj._vertices + obj._vertex_count, this->_vertices);
 }
 
 mv::CollisionShape<2>::Convex::Convex(Convex&& obj) noexcept
-	: _vertices{ obj._vertices }, _vertex_count{ obj._vertex_count }
+	: _inline_vertices{}, _vertices{ nullptr }, _vertex_count{ 0 }
 {
-	obj._vertices = nullptr;
-	obj._vertex_count = 0;
+	if (obj._vertices == obj._inline_vertices) {
+		this->_allocate(obj._vertex_count);
+		std::copy(obj._vertices, obj._vertices + obj._vertex_count, this->_vertices);
+	}
+	else {
+		this->_vertices = obj._vertices;
+		this->_vertex_count = obj._vertex_count;
+		obj._vertices = obj._inline_vertices;
+	}
+	obj._release();
 }
 
 
 mv::CollisionShape<2>::Convex::~Convex()
 {
-	delete[] this->_vertices;
-	this->_vertices = nullptr;
-	this->_vertex_count = 0;
+	this->_release();
 }
 
 
 mv::CollisionShape<2>::Convex& mv::CollisionShape<2>::Convex::operator=(const Convex& obj)
 {
 	if (this != &obj) {
-		delete[] this->_vertices;
-		this->_vertices = new vec2f[obj._vertex_count]{};
-		for (unsigned int i{ 0 }; i < this->_vertex_count; ++i) {
-			this->_vertices[i] = obj._vertices[i];
-		}
-		this->_vertex_count = obj._vertex_count;
+		this->_release();
+		this->_allocate(obj._vertex_count);
+		std::copy(obj._vertices, obj._vertices + obj._vertex_count, this->_vertices);
 	}
 	return *this;
 }
@@ -700,40 +1307,103 @@ mv::CollisionShape<2>::Convex& mv::CollisionShape<2>::Convex::operator=(const Co
 mv::CollisionShape<2>::Convex& mv::CollisionShape<2>::Convex::operator=(Convex&& obj) noexcept
 {
 	if (this != &obj) {
-		delete[] this->_vertices;
-		this->_vertices = obj._vertices;
-		this->_vertex_count = obj._vertex_count;
-		obj._vertices = nullptr;
-		obj._vertex_count = 0;
+		this->_release();
+		if (obj._vertices == obj._inline_vertices) {
+			this->_allocate(obj._vertex_count);
+			std::copy(obj._vertices, obj._vertices + obj._vertex_count, this->_vertices);
+		}
+		else {
+			this->_vertices = obj._vertices;
+			this->_vertex_count = obj._vertex_count;
+			obj._vertices = obj._inline_vertices;
+		}
+		obj._release();
 	}
 	return *this;
 }
 
 
 
-bool mv::CollisionShape<2>::Convex::collides(const Point&, const mat3f&, const mat3f&, vec2f&) const
+bool mv::CollisionShape<2>::Convex::collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	return false;
+	SupportHints hints{ 0, 0 };
+	return gjk_epa(*this, t0, other, t1, mtv, hints);
 }
 
-bool mv::CollisionShape<2>::Convex::collides(const Line&, const mat3f&, const mat3f&, vec2f&) const
+bool mv::CollisionShape<2>::Convex::collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	return false;
+	SupportHints hints{ 0, 0 };
+	return gjk_epa(*this, t0, other, t1, mtv, hints);
 }
 
-bool mv::CollisionShape<2>::Convex::collides(const Rectangle&, const mat3f&, const mat3f&, vec2f&) const
+bool mv::CollisionShape<2>::Convex::collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	return false;
+	SupportHints hints{ 0, 0 };
+	return gjk_epa(*this, t0, other, t1, mtv, hints);
 }
 
-bool mv::CollisionShape<2>::Convex::collides(const Ellipse&, const mat3f&, const mat3f&, vec2f&) const
+bool mv::CollisionShape<2>::Convex::collides(const Ellipse& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	return false;
+	SupportHints hints{ 0, 0 };
+	return gjk_epa(*this, t0, other, t1, mtv, hints);
 }
 
-bool mv::CollisionShape<2>::Convex::collides(const Convex&, const mat3f&, const mat3f&, vec2f&) const
+bool mv::CollisionShape<2>::Convex::collides(const Convex& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
 {
-	return false;
+	SupportHints hints{ 0, 0 };
+	return gjk_epa(*this, t0, other, t1, mtv, hints);
+}
+
+
+mv::vec2f mv::CollisionShape<2>::Convex::support(const Placement& t, const vec2f& direction) const
+{
+	unsigned int hint{ 0 };
+	return this->support(t, direction, hint);
+}
+
+mv::vec2f mv::CollisionShape<2>::Convex::support(const Placement& t, const vec2f& direction, unsigned int& hint) const
+{
+	if (this->_vertex_count == 0) {
+		return vec2f{ t.transform[0][2], t.transform[1][2] };
+	}
+
+	vec2f local{ local_direction(t, direction) };
+	unsigned int best{ 0 };
+	float best_dot{ local.dot(this->_vertices[0]) };
+	if (this->_vertex_count <= inline_capacity) { // scanning a small polygon is cheaper than walking it
+		for (unsigned int i{ 1 }; i < this->_vertex_count; ++i) {
+			float d{ local.dot(this->_vertices[i]) };
+			if (d > best_dot) {
+				best = i;
+				best_dot = d;
+			}
+		}
+	}
+	else {
+		// the projection onto direction has a single maximum along the outline, so walk uphill from the hint both ways.
+		// Equal projections are walked over, collinear vertices and edges facing away leave flat runs on the way up
+		best = hint % this->_vertex_count;
+		best_dot = local.dot(this->_vertices[best]);
+		for (unsigned int step : { 1u, this->_vertex_count - 1 }) {
+			unsigned int current{ best };
+			float current_dot{ best_dot };
+			for (unsigned int i{ 1 }; i < this->_vertex_count; ++i) {
+				unsigned int next{ (current + step) % this->_vertex_count };
+				float d{ local.dot(this->_vertices[next]) };
+				if (d < current_dot) {
+					break;
+				}
+				current = next;
+				current_dot = d;
+				if (d > best_dot) {
+					best = next;
+					best_dot = d;
+				}
+			}
+		}
+		hint = best;
+	}
+	return t.transform * vec3f{ this->_vertices[best], 1.f };
 }
 
 
@@ -755,6 +1425,370 @@ unsigned int mv::CollisionShape<2>::Convex::size() const
 }
 
 
+void mv::CollisionShape<2>::Convex::_allocate(unsigned int vertex_count)
+{
+	this->_vertices = vertex_count <= inline_capacity ? this->_inline_vertices : new vec2f[vertex_count]{};
+	this->_vertex_count = vertex_count;
+}
+
+void mv::CollisionShape<2>::Convex::_release()
+{
+	if (this->_vertices != this->_inline_vertices) {
+		delete[] this->_vertices;
+	}
+	this->_vertices = this->_inline_vertices;
+	this->_vertex_count = 0;
+}
+
+
+
+mv::CollisionShape<2>::Tilemap::Tilemap(unsigned int width, unsigned int height, const vec2f& tile_size, const bool* tiles)
+	: _width{ width }, _height{ height }, _tile_size{ tile_size }, _tile_runs(width * height, no_run), _runs{}
+{
+	// greedy: grow each run to the right from its first free tile, then down while the whole row below is free
+	for (unsigned int y{ 0 }; y < height; ++y) {
+		for (unsigned int x{ 0 }; x < width; ++x) {
+			if (!tiles[x + width * y] || this->_tile_runs[x + width * y] != no_run) {
+				continue;
+			}
+			Run run{ x, y, x + 1, y + 1 };
+			while (run.upper_x < width && tiles[run.upper_x + width * y] && this->_tile_runs[run.upper_x + width * y] == no_run) {
+				++run.upper_x;
+			}
+			for (; run.upper_y < height; ++run.upper_y) {
+				bool free{ true };
+				for (unsigned int i{ run.lower_x }; i < run.upper_x && free; ++i) {
+					free = tiles[i + width * run.upper_y] && this->_tile_runs[i + width * run.upper_y] == no_run;
+				}
+				if (!free) {
+					break;
+				}
+			}
+			unsigned int run_idx{ static_cast<unsigned int>(this->_runs.size()) };
+			for (unsigned int j{ run.lower_y }; j < run.upper_y; ++j) {
+				for (unsigned int i{ run.lower_x }; i < run.upper_x; ++i) {
+					this->_tile_runs[i + width * j] = run_idx;
+				}
+			}
+			this->_runs.push_back(run);
+		}
+	}
+}
+
+
+bool mv::CollisionShape<2>::Tilemap::collides(const CollisionShape<2>& other, const Placement& t0, const Placement& t1, vec2f& mtv) const
+{
+	// other is moved out of each run in turn, so a shape touching a floor and a wall leaves both
+	vec2f total{ 0.f, 0.f };
+	bool hit{ false };
+	this->_for_each_run(t0, t1.lower, t1.upper, [&other, &t1, &total, &hit](const CollisionShape<2>& run, const Placement& run_placement) {
+		vec2f run_mtv;
+		if (other.collides(run, total.squared_magnitude() == 0.f ? t1 : t1.translated(total), run_placement, run_mtv)) {
+			total += run_mtv;
+			hit = true;
+		}
+	});
+	mtv = -total;
+	return hit;
+}
+
+bool mv::CollisionShape<2>::Tilemap::time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+	const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal) const
+{
+	vec2f relative{ displacement1 - displacement0 };
+	vec2f lower{ std::min(t1.lower.x(), t1.lower.x() + relative.x()), std::min(t1.lower.y(), t1.lower.y() + relative.y()) };
+	vec2f upper{ std::max(t1.upper.x(), t1.upper.x() + relative.x()), std::max(t1.upper.y(), t1.upper.y() + relative.y()) };
+	bool hit{ false };
+	toi = 1.f;
+	this->_for_each_run(t0, lower, upper, [&](const CollisionShape<2>& run, const Placement& run_placement) {
+		float run_toi;
+		vec2f run_normal;
+		if (other.time_of_impact(run, t1, displacement1, run_placement, displacement0, run_toi, run_normal) && (!hit || run_toi < toi)) {
+			toi = run_toi;
+			normal = -run_normal;
+			hit = true;
+		}
+	});
+	return hit;
+}
+
+
+bool mv::CollisionShape<2>::Tilemap::tile(unsigned int x, unsigned int y) const
+{
+	return this->_tile_runs[x + this->_width * y] != no_run;
+}
+
+unsigned int mv::CollisionShape<2>::Tilemap::width() const
+{
+	return this->_width;
+}
+
+unsigned int mv::CollisionShape<2>::Tilemap::height() const
+{
+	return this->_height;
+}
+
+const mv::vec2f& mv::CollisionShape<2>::Tilemap::tile_size() const
+{
+	return this->_tile_size;
+}
+
+unsigned int mv::CollisionShape<2>::Tilemap::run_count() const
+{
+	return static_cast<unsigned int>(this->_runs.size());
+}
+
+
+template <typename F>
+void mv::CollisionShape<2>::Tilemap::_for_each_run(const Placement& t, const vec2f& lower, const vec2f& upper, F&& f) const
+{
+	// world space bounds to a range of tiles
+	vec2f local_lower{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+	vec2f local_upper{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+	for (const vec2f& corner : { lower, vec2f{ upper.x(), lower.y() }, upper, vec2f{ lower.x(), upper.y() } }) {
+		vec2f local{ t.inverse * vec3f{ corner, 1.f } };
+		local_lower.x() = std::min(local_lower.x(), local.x());
+		local_lower.y() = std::min(local_lower.y(), local.y());
+		local_upper.x() = std::max(local_upper.x(), local.x());
+		local_upper.y() = std::max(local_upper.y(), local.y());
+	}
+	float size_x{ static_cast<float>(this->_width) };
+	float size_y{ static_cast<float>(this->_height) };
+	float first_x{ std::floor(local_lower.x() / this->_tile_size.x()) };
+	float first_y{ std::floor(local_lower.y() / this->_tile_size.y()) };
+	float last_x{ std::floor(local_upper.x() / this->_tile_size.x()) };
+	float last_y{ std::floor(local_upper.y() / this->_tile_size.y()) };
+	if (!(last_x >= 0.f && last_y >= 0.f && first_x < size_x && first_y < size_y)) {
+		return;
+	}
+	unsigned int x0{ static_cast<unsigned int>(std::max(first_x, 0.f)) };
+	unsigned int y0{ static_cast<unsigned int>(std::max(first_y, 0.f)) };
+	unsigned int x1{ static_cast<unsigned int>(std::min(last_x, size_x - 1.f)) };
+	unsigned int y1{ static_cast<unsigned int>(std::min(last_y, size_y - 1.f)) };
+
+	for (unsigned int y{ y0 }; y <= y1; ++y) {
+		for (unsigned int x{ x0 }; x <= x1; ++x) {
+			unsigned int run_idx{ this->_tile_runs[x + this->_width * y] };
+			if (run_idx == no_run) {
+				continue;
+			}
+			// a run is visited at its first tile inside the range only
+			const Run& run{ this->_runs[run_idx] };
+			if (x != std::max(run.lower_x, x0) || y != std::max(run.lower_y, y0)) {
+				continue;
+			}
+			vec2f run_lower{ static_cast<float>(run.lower_x) * this->_tile_size.x(), static_cast<float>(run.lower_y) * this->_tile_size.y() };
+			vec2f run_upper{ static_cast<float>(run.upper_x) * this->_tile_size.x(), static_cast<float>(run.upper_y) * this->_tile_size.y() };
+			CollisionShape<2> shape{ Rectangle{ run_lower, run_upper } };
+			Placement placement;
+			placement.transform = t.transform;
+			placement.inverse = t.inverse;
+			placement.lower = vec2f{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+			placement.upper = vec2f{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+			for (const vec2f& corner : { run_lower, vec2f{ run_upper.x(), run_lower.y() }, run_upper, vec2f{ run_lower.x(), run_upper.y() } }) {
+				vec2f v{ t.transform * vec3f{ corner, 1.f } };
+				placement.lower.x() = std::min(placement.lower.x(), v.x());
+				placement.lower.y() = std::min(placement.lower.y(), v.y());
+				placement.upper.x() = std::max(placement.upper.x(), v.x());
+				placement.upper.y() = std::max(placement.upper.y(), v.y());
+			}
+			f(shape, placement);
+		}
+	}
+}
+
+
+
+mv::CollisionShape<3>::CollisionShape()
+	: _type{ Type::none }
+{}
+
+mv::CollisionShape<3>::CollisionShape(const Box& b)
+	: _box(b), _type{ Type::box }
+{}
+
+
+
+bool mv::CollisionShape<3>::collides(const CollisionShape& other, const mat4f& t0, const mat4f& t1, vec3f& mtv) const
+{
+	return this->collides(other, this->place(t0), other.place(t1), mtv);
+}
+
+bool mv::CollisionShape<3>::collides(const CollisionShape& other, const Placement& t0, const Placement& t1, vec3f& mtv) const
+{
+	if (this->_type == Type::box && other._type == Type::box) {
+		return this->_box.collides(other._box, t0, t1, mtv);
+	}
+	mtv = vec3f{ 0.f, 0.f, 0.f };
+	return false;
+}
+
+bool mv::CollisionShape<3>::collides(const CollisionShape& other, const Placement& t0, const Placement& t1, vec3f& mtv, SupportHints&) const
+{
+	return this->collides(other, t0, t1, mtv);
+}
+
+bool mv::CollisionShape<3>::collides(const CollisionShape& other, const mat4f& t0, const mat4f& t1) const
+{
+	vec3f mtvDummy;
+	return this->collides(other, t0, t1, mtvDummy);
+}
+
+bool mv::CollisionShape<3>::time_of_impact(const CollisionShape& other, const Placement& t0, const vec3f& displacement0,
+	const Placement& t1, const vec3f& displacement1, float& toi, vec3f& normal) const
+{
+	if (this->_type == Type::none || other._type == Type::none) {
+		return false;
+	}
+
+	// slab test of the bounds of this shape moving relative to the bounds of other
+	vec3f displacement{ displacement0 - displacement1 };
+	float enter{ -std::numeric_limits<float>::infinity() };
+	float exit{ std::numeric_limits<float>::infinity() };
+	unsigned int enter_axis{ 0 };
+	for (unsigned int i{ 0 }; i < 3; ++i) {
+		if (displacement[i] == 0.f) {
+			if (t1.upper[i] < t0.lower[i] || t0.upper[i] < t1.lower[i])
+				return false;
+			continue;
+		}
+		float axis_enter{ ((displacement[i] > 0.f ? t1.lower[i] - t0.upper[i] : t1.upper[i] - t0.lower[i])) / displacement[i] };
+		float axis_exit{ ((displacement[i] > 0.f ? t1.upper[i] - t0.lower[i] : t1.lower[i] - t0.upper[i])) / displacement[i] };
+		if (axis_enter > enter) {
+			enter = axis_enter;
+			enter_axis = i;
+		}
+		exit = std::min(exit, axis_exit);
+	}
+	if (enter <= 0.f || exit < enter || enter > 1.f) {
+		return false; // overlapping at the start, or no touch during the movement
+	}
+	toi = enter;
+	normal = vec3f{ 0.f, 0.f, 0.f };
+	normal[enter_axis] = displacement[enter_axis] > 0.f ? -1.f : 1.f;
+	return true;
+}
+
+bool mv::CollisionShape<3>::time_of_impact(const CollisionShape& other, const Placement& t0, const vec3f& displacement0,
+	const Placement& t1, const vec3f& displacement1, float& toi, vec3f& normal, SupportHints&) const
+{
+	return this->time_of_impact(other, t0, displacement0, t1, displacement1, toi, normal);
+}
+
+
+
+mv::CollisionShape<3>::Placement mv::CollisionShape<3>::place(const mat4f& t) const
+{
+	return this->place(t, t.affine_inverse());
+}
+
+mv::CollisionShape<3>::Placement mv::CollisionShape<3>::place(const mat4f& t, const mat4f& inverse) const
+{
+	Placement placement;
+	placement.transform = t;
+	placement.inverse = inverse;
+	if (this->_type == Type::box) {
+		this->_box.bounds(t, placement.lower, placement.upper);
+	}
+	else {
+		placement.lower = vec3f{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+		placement.upper = vec3f{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+	}
+	return placement;
+}
+
+
+bool mv::CollisionShape<3>::Placement::overlaps(const Placement& other) const
+{
+	for (unsigned int i{ 0 }; i < 3; ++i) {
+		if (other.upper[i] < this->lower[i] || this->upper[i] < other.lower[i])
+			return false;
+	}
+	return true;
+}
+
+mv::CollisionShape<3>::Placement mv::CollisionShape<3>::Placement::translated(const vec3f& offset) const
+{
+	Placement placement{ *this };
+	for (unsigned int i{ 0 }; i < 3; ++i) {
+		placement.transform[i][3] += offset[i];
+	}
+	placement.inverse = placement.transform.affine_inverse();
+	placement.lower += offset;
+	placement.upper += offset;
+	return placement;
+}
+
+
+
+const mv::CollisionShape<3>::Box& mv::CollisionShape<3>::as_box() const
+{
+	return this->_box;
+}
+
+
+mv::CollisionShape<3>::Type mv::CollisionShape<3>::type() const
+{
+	return this->_type;
+}
+
+
+
+
+mv::CollisionShape<3>::Box::Box(const vec3f& lower_xyz, const vec3f& upper_xyz)
+	: _lower_xyz{ lower_xyz }, _upper_xyz{ upper_xyz }
+{}
+
+
+
+bool mv::CollisionShape<3>::Box::collides(const Box&, const Placement& t0, const Placement& t1, vec3f& mtv) const
+{
+	// the placement bounds are the world space bounds of the box
+	float o[3];
+	for (unsigned int i{ 0 }; i < 3; ++i) {
+		if (!overlap(t0.lower[i], t0.upper[i], t1.lower[i], t1.upper[i], o[i])) {
+			mtv = vec3f{ 0.f, 0.f, 0.f };
+			return false;
+		}
+	}
+
+	std::ptrdiff_t i{ std::min_element(o, o + 3, [](float lhs, float rhs) { return std::abs(lhs) < std::abs(rhs); }) - o };
+	mtv = vec3f::basis()[i] * o[i];
+	return true;
+}
+
+
+
+const mv::vec3f& mv::CollisionShape<3>::Box::lower_xyz() const
+{
+	return this->_lower_xyz;
+}
+
+const mv::vec3f& mv::CollisionShape<3>::Box::upper_xyz() const
+{
+	return this->_upper_xyz;
+}
+
+
+void mv::CollisionShape<3>::Box::bounds(const mat4f& t, vec3f& lower, vec3f& upper) const
+{
+	lower = vec3f{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+	upper = vec3f{ -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+	for (unsigned int corner{ 0 }; corner < 8; ++corner) {
+		vec3f v{
+			corner & 1 ? this->_upper_xyz.x() : this->_lower_xyz.x(),
+			corner & 2 ? this->_upper_xyz.y() : this->_lower_xyz.y(),
+			corner & 4 ? this->_upper_xyz.z() : this->_lower_xyz.z() };
+		v = t * vec4f{ v, 1.f };
+		for (unsigned int i{ 0 }; i < 3; ++i) {
+			lower[i] = std::min(lower[i], v[i]);
+			upper[i] = std::max(upper[i], v[i]);
+		}
+	}
+}
+
+
+
 
 template class mv::CollisionShape<2>;
 template class mv::CollisionShape<3>;
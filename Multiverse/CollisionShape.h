@@ -3,6 +3,7 @@
 
 #include <initializer_list> // initializer_list
 #include <type_traits>	// enable_if, is_same
+#include <vector>	// vector
 
 #include "Vector.h"
 #include "Matrix.h"
@@ -13,6 +14,18 @@ namespace mv
 	template <uint dims>
 	class CollisionShape;
 
+	/**
+		\brief polygon vertices at which the support searches of a pair of shapes start
+
+		Filled in by every collision test of the pair, so callers that test the same pair every tick keep them and
+		start the next test next to the vertices the last one ended on.
+	*/
+	struct SupportHints
+	{
+		unsigned int vertex0; // of the first shape of the pair
+		unsigned int vertex1;
+	};
+
 	template <>
 	class CollisionShape<2>
 	{
@@ -24,15 +37,41 @@ namespace mv
 			rectangle,
 			ellipse,
 			convex,
+			tilemap,
 			none
 		};
 
+		/**
+			\brief shape space to world space transformation of a shape
+
+			Computed once per tick by place and shared by every pair the shape takes part in.
+		*/
+		struct Placement
+		{
+			mat3f transform; // includes the rotation of rectangles and the unit circle transformation of ellipses
+			mat3f inverse;
+			vec2f lower; // world space bounds
+			vec2f upper;
+
+
+			bool overlaps(const Placement& other) const;
+			/**
+				\brief get the placement moved by offset in world space
+			*/
+			Placement translated(const vec2f& offset) const;
+		};
+
 		struct Point
 		{
 			vec2f p0;
 
 
-			bool collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
+			bool collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+
+			/**
+				\brief get the world space point of the shape furthest in direction, used by the convex collision tests
+			*/
+			vec2f support(const Placement& t, const vec2f& direction) const;
 		};
 		struct Line
 		{
@@ -40,8 +79,10 @@ namespace mv
 			vec2f p1;
 
 
-			bool collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
+			bool collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+
+			vec2f support(const Placement& t, const vec2f& direction) const;
 		};
 		class Rectangle
 		{
@@ -55,9 +96,11 @@ namespace mv
 			Rectangle(const vec2f& lower_xy, const vec2f& upper_xy, float angle = 0.f);
 
 
-			bool collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Rectangle& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
+			bool collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+
+			vec2f support(const Placement& t, const vec2f& direction) const;
 
 
 			const vec2f& lower_xy() const;
@@ -70,6 +113,10 @@ namespace mv
 			float angle() const;
 
 			mat3f apply_rotation(const mat3f& m) const;
+			/**
+				\brief undo apply_rotation on an inverse matrix, the inverse of apply_rotation(m) is apply_inverse_rotation(m^-1)
+			*/
+			mat3f apply_inverse_rotation(const mat3f& m) const;
 		};
 		class Ellipse
 		{
@@ -83,10 +130,12 @@ namespace mv
 			Ellipse(const vec2f& centre, const vec2f& radii, float angle = 0.f);
 
 
-			bool collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Rectangle& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Ellipse& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
+			bool collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Ellipse& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+
+			vec2f support(const Placement& t, const vec2f& direction) const;
 
 
 			const vec2f& centre() const;
@@ -96,11 +145,24 @@ namespace mv
 
 			mat3f apply_rotation(const mat3f& m) const;
 			mat3f apply_transform(const mat3f& m) const;
+			/**
+				\brief undo apply_transform on an inverse matrix, the inverse of apply_transform(m) is apply_inverse_transform(m^-1)
+			*/
+			mat3f apply_inverse_transform(const mat3f& m) const;
 		};
+		/**
+			\brief convex polygon, vertices in winding order
+
+			Polygons of up to inline_capacity vertices are stored inside the shape without allocating.
+		*/
 		class Convex
 		{
+		public:
+			static constexpr unsigned int inline_capacity = 8;
+
 		private:
-			vec2f* _vertices;
+			vec2f _inline_vertices[inline_capacity];
+			vec2f* _vertices; // _inline_vertices or a heap array for larger polygons
 			unsigned int _vertex_count;
 
 		public:
@@ -117,17 +179,94 @@ namespace mv
 			Convex& operator=(Convex&& obj) noexcept;
 
 
-			bool collides(const Point& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Line& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Rectangle& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Ellipse& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
-			bool collides(const Convex& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
+			bool collides(const Point& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Line& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Rectangle& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Ellipse& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			bool collides(const Convex& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+
+			/**
+				\brief get the world space vertex furthest in direction
+			*/
+			vec2f support(const Placement& t, const vec2f& direction) const;
+			/**
+				\brief get the world space vertex furthest in direction, starting the search at a hint
+				\param hint vertex to start from, receives the vertex found
+
+				Large polygons are searched by walking the outline from the hint. Callers that query one shape repeatedly,
+				such as GJK, keep the hint between queries, which is usually at or next to the answer because successive
+				directions are close. Of several vertices equally far in direction, the first one walked over is returned.
+			*/
+			vec2f support(const Placement& t, const vec2f& direction, unsigned int& hint) const;
 
 
 			const vec2f& operator[](unsigned int i) const;
 			vec2f& operator[](unsigned int i);
 
 			unsigned int size() const;
+
+		private:
+			void _allocate(unsigned int vertex_count);
+			void _release();
+		};
+		/**
+			\brief grid of solid tiles, such as a level, in a single shape
+
+			Tile (x, y) covers [x, x + 1] * tile_size by [y, y + 1] * tile_size in shape space. Adjacent solid tiles are
+			merged into rectangular runs once on construction; queries only visit the runs under the tiles the other shape
+			covers, so they cost the amount of touched tiles rather than the size of the grid.
+		*/
+		class Tilemap
+		{
+		private:
+			struct Run
+			{
+				unsigned int lower_x; // first tile
+				unsigned int lower_y;
+				unsigned int upper_x; // one past the last tile
+				unsigned int upper_y;
+			};
+
+			static constexpr unsigned int no_run = ~0u;
+
+			unsigned int _width;
+			unsigned int _height;
+			vec2f _tile_size;
+			std::vector<unsigned int> _tile_runs; // run of each tile, no_run for empty tiles
+			std::vector<Run> _runs;
+
+		public:
+			/**
+				\param tiles width * height solid flags, tile (x, y) at x + width * y
+			*/
+			Tilemap(unsigned int width, unsigned int height, const vec2f& tile_size, const bool* tiles);
+
+
+			/**
+				\brief collide other with the runs it touches, moving it out of each run in turn
+				\param mtv receives the summed translation, to be added to the tilemap
+			*/
+			bool collides(const CollisionShape<2>& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+			/**
+				\brief earliest time of impact of other against the runs it sweeps over
+				\see CollisionShape<2>::time_of_impact
+			*/
+			bool time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+				const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal) const;
+
+
+			bool tile(unsigned int x, unsigned int y) const;
+			unsigned int width() const;
+			unsigned int height() const;
+			const vec2f& tile_size() const;
+			unsigned int run_count() const;
+
+		private:
+			/**
+				\brief call f with the shape space rectangle of every run overlapping the world space bounds once
+			*/
+			template <typename F>
+			void _for_each_run(const Placement& t, const vec2f& lower, const vec2f& upper, F&& f) const;
 		};
 
 	private:
@@ -138,6 +277,7 @@ namespace mv
 			Rectangle _rectangle;
 			Ellipse _ellipse;
 			Convex _convex;
+			Tilemap _tilemap;
 		};
 		Type _type;
 
@@ -149,10 +289,12 @@ namespace mv
 		CollisionShape(const Ellipse& e);
 		CollisionShape(const Convex& x);
 		CollisionShape(Convex&& x);
+		CollisionShape(const Tilemap& m);
+		CollisionShape(Tilemap&& m);
 		CollisionShape(const CollisionShape<2>& other);
 		CollisionShape(CollisionShape<2>&& other) noexcept;
 
-		~CollisionShape();	// defaulted in HitBox.cpp because of implicit deletion from undefined member class destructors
+		~CollisionShape();
 
 		CollisionShape& operator=(const CollisionShape<2>& other);
 		CollisionShape& operator=(CollisionShape<2>&& other) noexcept;
@@ -160,6 +302,40 @@ namespace mv
 
 		bool collides(const CollisionShape<2>& other, const mat3f& t0, const mat3f& t1, vec2f& mtv) const;
 		bool collides(const CollisionShape<2>& other, const mat3f& t0, const mat3f& t1) const;
+		bool collides(const CollisionShape<2>& other, const Placement& t0, const Placement& t1, vec2f& mtv) const;
+		/**
+			\brief collide with other, starting the support searches of convex polygons at hints and updating them
+		*/
+		bool collides(const CollisionShape<2>& other, const Placement& t0, const Placement& t1, vec2f& mtv, SupportHints& hints) const;
+		/**
+			\brief find when this shape first touches other while both move in a straight line
+			\param t0 placement of this shape at the start of the movement
+			\param displacement0 movement of this shape
+			\param toi receives the fraction of the movement after which the shapes touch
+			\param normal receives the direction in which this shape is pushed away from other at the touch
+			\returns whether the shapes touch during the movement, shapes that already overlap at the start do not
+
+			Conservative advancement: each step moves the shapes by their distance divided by how fast that distance closes,
+			which can never step past the first touch. Rotation during the movement is not taken into account.
+		*/
+		bool time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+			const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal) const;
+		/**
+			\brief time of impact, starting the support searches of convex polygons at hints and updating them
+		*/
+		bool time_of_impact(const CollisionShape<2>& other, const Placement& t0, const vec2f& displacement0,
+			const Placement& t1, const vec2f& displacement1, float& toi, vec2f& normal, SupportHints& hints) const;
+
+		/**
+			\brief get placement of the shape in world space
+			\param t shape transformation matrix, usually the entity transformation
+		*/
+		Placement place(const mat3f& t) const;
+		/**
+			\brief get placement of the shape in world space from a transformation whose inverse is already known
+			\param inverse inverse of t, such as Transform::inverse_transform_matrix, spares the general inverse
+		*/
+		Placement place(const mat3f& t, const mat3f& inverse) const;
 
 
 		const Point& as_point() const;
@@ -167,24 +343,113 @@ namespace mv
 		const Rectangle& as_rectangle() const;
 		const Ellipse& as_ellipse() const;
 		const Convex& as_convex() const;
+		const Tilemap& as_tilemap() const;
 
 		Type type() const;
+
+	private:
+		void _construct(const CollisionShape<2>& other);
+		void _construct(CollisionShape<2>&& other);
+		void _destroy();
 	};
 
 	template <>
 	class CollisionShape<3>
 	{
 	public:
-		CollisionShape() = default;
+		enum class Type
+		{
+			box,
+			none
+		};
 
-		bool collides(const CollisionShape&, const mat4f&, const mat4f&, vec3f&) const
+		/**
+			\brief shape space to world space transformation of a shape
+
+			Computed once per tick by place and shared by every pair the shape takes part in.
+		*/
+		struct Placement
 		{
-			return false;
-		}
-		bool collides(const CollisionShape&, const mat4f&, const mat4f&) const
+			mat4f transform;
+			mat4f inverse;
+			vec3f lower; // world space bounds
+			vec3f upper;
+
+
+			bool overlaps(const Placement& other) const;
+			/**
+				\brief get the placement moved by offset in world space
+			*/
+			Placement translated(const vec3f& offset) const;
+		};
+
+		class Box
 		{
-			return false;
-		}
+		private:
+			vec3f _lower_xyz;
+			vec3f _upper_xyz;
+
+		public:
+			Box(const vec3f& lower_xyz, const vec3f& upper_xyz);
+
+
+			bool collides(const Box& other, const Placement& t0, const Placement& t1, vec3f& mtv) const;
+
+
+			const vec3f& lower_xyz() const;
+			const vec3f& upper_xyz() const;
+
+			/**
+				\brief get axis aligned bounds of the transformed box
+			*/
+			void bounds(const mat4f& t, vec3f& lower, vec3f& upper) const;
+		};
+
+	private:
+		union
+		{
+			Box _box;
+		};
+		Type _type;
+
+	public:
+		CollisionShape();
+		CollisionShape(const Box& b);
+
+
+		bool collides(const CollisionShape<3>& other, const mat4f& t0, const mat4f& t1, vec3f& mtv) const;
+		bool collides(const CollisionShape<3>& other, const mat4f& t0, const mat4f& t1) const;
+		bool collides(const CollisionShape<3>& other, const Placement& t0, const Placement& t1, vec3f& mtv) const;
+		/**
+			\brief same as collides without hints, 3D shapes have no polygons to search
+		*/
+		bool collides(const CollisionShape<3>& other, const Placement& t0, const Placement& t1, vec3f& mtv, SupportHints& hints) const;
+		/**
+			\brief find when this shape first touches other while both move in a straight line
+
+			3D shapes have no support functions yet, so this is the time at which the world bounds first touch.
+			\see CollisionShape<2>::time_of_impact
+		*/
+		bool time_of_impact(const CollisionShape<3>& other, const Placement& t0, const vec3f& displacement0,
+			const Placement& t1, const vec3f& displacement1, float& toi, vec3f& normal) const;
+		bool time_of_impact(const CollisionShape<3>& other, const Placement& t0, const vec3f& displacement0,
+			const Placement& t1, const vec3f& displacement1, float& toi, vec3f& normal, SupportHints& hints) const;
+
+		/**
+			\brief get placement of the shape in world space
+			\param t shape transformation matrix, usually the entity transformation
+		*/
+		Placement place(const mat4f& t) const;
+		/**
+			\brief get placement of the shape in world space from a transformation whose inverse is already known
+			\param inverse inverse of t, such as Transform::inverse_transform_matrix, spares the general inverse
+		*/
+		Placement place(const mat4f& t, const mat4f& inverse) const;
+
+
+		const Box& as_box() const;
+
+		Type type() const;
 	};
 }
 
@@ -3,8 +3,9 @@
 
 template <typename InputIterator>
 mv::CollisionShape<2>::Convex::Convex(InputIterator first, InputIterator last)
-	: _vertices{ new vec2f[last - first]{} }, _vertex_count{ last - first }
+	: _inline_vertices{}, _vertices{ nullptr }, _vertex_count{ 0 }
 {
+	this->_allocate(static_cast<unsigned int>(last - first));
 	for (unsigned int i{ 0 }; first != last; ++i, ++first) {
 		this->_vertices[i] = *first;
 	}
@@ -0,0 +1,140 @@
+#include "MultiversePCH.h"
+#include <catch.hpp>
+#include "CollisionShape.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace mv;
+
+TEST_CASE("Identical ellipses offset along their major axis", "CollisionShape")
+{
+	// b maps onto a circle in the unit space of a, so both eigenvalues of the closest point solve are equal
+	CollisionShape<2> ellipse{ CollisionShape<2>::Ellipse{ vec2f{ 0.f, 0.f }, vec2f{ 2.f, 1.f } } };
+	CollisionShape<2>::Placement t0{ ellipse.place(mat3f::identity()) };
+	vec2f mtv;
+
+	for (float distance : { 1.f, 2.5f, 3.9f }) {
+		CollisionShape<2>::Placement t1{ ellipse.place(mat3f::transform(vec2f{ distance, 0.f }, 0.f, vec2f{ 1.f, 1.f })) };
+		REQUIRE(ellipse.collides(ellipse, t0, t1, mtv));
+		REQUIRE(mtv.x() == Approx(distance - 4.f).margin(1e-4f));
+		REQUIRE(mtv.y() == Approx(0.f).margin(1e-4f));
+	}
+
+	CollisionShape<2>::Placement t1{ ellipse.place(mat3f::transform(vec2f{ 4.1f, 0.f }, 0.f, vec2f{ 1.f, 1.f })) };
+	REQUIRE_FALSE(ellipse.collides(ellipse, t0, t1, mtv));
+}
+
+TEST_CASE("Identical ellipses offset diagonally", "CollisionShape")
+{
+	CollisionShape<2> ellipse{ CollisionShape<2>::Ellipse{ vec2f{ 0.f, 0.f }, vec2f{ 2.f, 1.f } } };
+	CollisionShape<2>::Placement t0{ ellipse.place(mat3f::identity()) };
+	vec2f mtv;
+
+	// the boundaries of a and of a moved by (2, 1) cross, the translation separates them along the offset
+	CollisionShape<2>::Placement t1{ ellipse.place(mat3f::transform(vec2f{ 2.f, 1.f }, 0.f, vec2f{ 1.f, 1.f })) };
+	REQUIRE(ellipse.collides(ellipse, t0, t1, mtv));
+	REQUIRE(mtv.x() * 1.f - mtv.y() * 2.f == Approx(0.f).margin(1e-4f));
+
+	t1 = ellipse.place(mat3f::transform(vec2f{ 2.9f, 1.45f }, 0.f, vec2f{ 1.f, 1.f }));
+	REQUIRE_FALSE(ellipse.collides(ellipse, t0, t1, mtv));
+}
+
+TEST_CASE("Convex polygon against a rectangle", "CollisionShape")
+{
+	CollisionShape<2> square{ CollisionShape<2>::Convex{ vec2f{ -1.f, -1.f }, vec2f{ 1.f, -1.f }, vec2f{ 1.f, 1.f }, vec2f{ -1.f, 1.f } } };
+	CollisionShape<2> rectangle{ CollisionShape<2>::Rectangle{ vec2f{ -1.f, -0.5f }, vec2f{ 1.f, 0.5f } } };
+	CollisionShape<2>::Placement t0{ square.place(mat3f::identity()) };
+	vec2f mtv;
+
+	// the rectangle reaches 0.5 into the square from the right, less than along y
+	CollisionShape<2>::Placement t1{ rectangle.place(mat3f::transform(vec2f{ 1.5f, 0.3f }, 0.f, vec2f{ 1.f, 1.f })) };
+	REQUIRE(square.collides(rectangle, t0, t1, mtv));
+	REQUIRE(mtv.x() == Approx(-0.5f).margin(1e-3f));
+	REQUIRE(mtv.y() == Approx(0.f).margin(1e-3f));
+
+	// the other way round the mtv moves the rectangle instead
+	REQUIRE(rectangle.collides(square, t1, t0, mtv));
+	REQUIRE(mtv.x() == Approx(0.5f).margin(1e-3f));
+	REQUIRE(mtv.y() == Approx(0.f).margin(1e-3f));
+
+	t1 = rectangle.place(mat3f::transform(vec2f{ 2.1f, 0.3f }, 0.f, vec2f{ 1.f, 1.f }));
+	REQUIRE_FALSE(square.collides(rectangle, t0, t1, mtv));
+}
+
+TEST_CASE("Convex polygons against each other", "CollisionShape")
+{
+	// 12 vertices, more than are kept inline, starting at (-1, 0) so vertex 6 lies at (1, 0)
+	std::vector<vec2f> vertices;
+	for (unsigned int i{ 0 }; i < 12; ++i) {
+		float angle{ pi + static_cast<float>(i) * pi / 6.f };
+		vertices.push_back(vec2f{ std::cos(angle), std::sin(angle) });
+	}
+	CollisionShape<2> polygon{ CollisionShape<2>::Convex(vertices.begin(), vertices.end()) };
+	CollisionShape<2> square{ CollisionShape<2>::Convex{ vec2f{ -1.f, -1.f }, vec2f{ 1.f, -1.f }, vec2f{ 1.f, 1.f }, vec2f{ -1.f, 1.f } } };
+	CollisionShape<2>::Placement t0{ polygon.place(mat3f::identity()) };
+	CollisionShape<2>::Placement t1{ square.place(mat3f::transform(vec2f{ 1.8f, 0.f }, 0.f, vec2f{ 1.f, 1.f })) };
+	vec2f mtv;
+
+	// the vertex at (1, 0) reaches 0.2 past the left side of the square, the edge normals of the polygon overlap more
+	REQUIRE(polygon.collides(square, t0, t1, mtv));
+	REQUIRE(mtv.x() == Approx(-0.2f).margin(1e-3f));
+	REQUIRE(mtv.y() == Approx(0.f).margin(1e-3f));
+
+	// hints end on the vertex found, and a test started from them finds the same mtv
+	SupportHints hints{ 0, 0 };
+	vec2f hinted_mtv;
+	REQUIRE(polygon.collides(square, t0, t1, hinted_mtv, hints));
+	REQUIRE(hints.vertex0 == 6);
+	REQUIRE(hinted_mtv.x() == Approx(-0.2f).margin(1e-3f));
+	REQUIRE(square.collides(polygon, t1, t0, hinted_mtv, hints));
+	REQUIRE(hints.vertex1 == 6);
+	REQUIRE(hinted_mtv.x() == Approx(0.2f).margin(1e-3f));
+	REQUIRE(hinted_mtv.y() == Approx(0.f).margin(1e-3f));
+
+	t1 = square.place(mat3f::transform(vec2f{ 2.1f, 0.f }, 0.f, vec2f{ 1.f, 1.f }));
+	REQUIRE_FALSE(polygon.collides(square, t0, t1, mtv, hints));
+}
+
+TEST_CASE("Tilemap merges solid tiles into runs", "CollisionShape")
+{
+	// greedy runs: rows 0 and 1 of columns 0 to 2, then the last two tiles of row 2
+	const bool tiles[]{
+		true, true, true, false,
+		true, true, true, false,
+		false, false, true, true };
+	CollisionShape<2>::Tilemap tilemap{ 4, 3, vec2f{ 1.f, 1.f }, tiles };
+
+	REQUIRE(tilemap.run_count() == 2);
+	for (unsigned int y{ 0 }; y < 3; ++y) {
+		for (unsigned int x{ 0 }; x < 4; ++x) {
+			REQUIRE(tilemap.tile(x, y) == tiles[x + 4 * y]);
+		}
+	}
+}
+
+TEST_CASE("Rectangle resting across two tilemap runs", "CollisionShape")
+{
+	// runs columns 0 to 1 of rows 0 and 1, and column 2 of row 1, so the top at y = 2 is split between them
+	const bool tiles[]{
+		true, true, false,
+		true, true, true };
+	CollisionShape<2> tilemap{ CollisionShape<2>::Tilemap{ 3, 2, vec2f{ 1.f, 1.f }, tiles } };
+	CollisionShape<2> rectangle{ CollisionShape<2>::Rectangle{ vec2f{ -0.5f, -0.5f }, vec2f{ 0.5f, 0.5f } } };
+	REQUIRE(tilemap.as_tilemap().run_count() == 2);
+	CollisionShape<2>::Placement t0{ tilemap.place(mat3f::identity()) };
+	CollisionShape<2>::Placement t1{ rectangle.place(mat3f::transform(vec2f{ 2.f, 2.3f }, 0.f, vec2f{ 1.f, 1.f })) };
+	vec2f mtv;
+
+	// the first run pushes the rectangle out of both, it is not pushed out of the second one again
+	REQUIRE(tilemap.collides(rectangle, t0, t1, mtv));
+	REQUIRE(mtv.x() == Approx(0.f).margin(1e-4f));
+	REQUIRE(mtv.y() == Approx(-0.2f).margin(1e-4f));
+
+	REQUIRE(rectangle.collides(tilemap, t1, t0, mtv));
+	REQUIRE(mtv.x() == Approx(0.f).margin(1e-4f));
+	REQUIRE(mtv.y() == Approx(0.2f).margin(1e-4f));
+
+	t1 = rectangle.place(mat3f::transform(vec2f{ 2.f, 2.6f }, 0.f, vec2f{ 1.f, 1.f }));
+	REQUIRE_FALSE(tilemap.collides(rectangle, t0, t1, mtv));
+}
@@ -45,7 +45,7 @@ namespace mv
 	public:
 		static constexpr UpdateStage update_stage = UpdateStage::render;
 
-		Matrix<float, dims + 1, dims + 1> transform; // model transform matrix
+		Matrix<float, dims + 1, dims + 1> transform; // model transform matrix, set from the entity transform before every render update
 
 	protected:
 		Component() = default;
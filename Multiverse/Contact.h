@@ -0,0 +1,104 @@
+#pragma once
+#include "setup.h"
+
+#include <algorithm> // lower_bound
+#include <vector>
+
+#include "Transform.h"
+#include "CollisionShape.h"
+
+namespace mv
+{
+	template <uint dims>
+	class Entity;
+
+	/**
+		\brief identifies a pair of colliders across ticks
+	*/
+	struct ContactKey
+	{
+		id_type entity0;
+		id_type entity1;
+		uint collider0; // index of the collider in entity0
+		uint collider1;
+
+
+		bool operator==(const ContactKey& other) const
+		{
+			return this->entity0 == other.entity0 && this->entity1 == other.entity1 &&
+				this->collider0 == other.collider0 && this->collider1 == other.collider1;
+		}
+
+		bool operator<(const ContactKey& other) const
+		{
+			if (this->entity0 != other.entity0)
+				return this->entity0 < other.entity0;
+			if (this->entity1 != other.entity1)
+				return this->entity1 < other.entity1;
+			if (this->collider0 != other.collider0)
+				return this->collider0 < other.collider0;
+			return this->collider1 < other.collider1;
+		}
+	};
+
+	/**
+		\brief pair of colliders of which at least one overlaps the other
+	*/
+	struct Overlap
+	{
+		ContactKey key; // entity0 is always the lower id, so a pair has the same key every tick
+		byte sides; // bit 0 set when collider0 overlaps collider1, bit 1 when collider1 overlaps collider0
+	};
+
+	/**
+		\brief contact manifold between two blocking colliders
+
+		Shapes are only ever pushed apart by translation, so a manifold has a single point.
+	*/
+	template <uint dims>
+	struct Contact
+	{
+		using position_type = decltype(Transform<dims>::translate);
+
+		ContactKey key;
+		position_type point; // centre of the overlap of the collider bounds
+		position_type normal; // direction in which entity0 is pushed out of entity1
+		float depth;
+		float correction; // total push along the normal, reused as starting point in the next tick
+		SupportHints hints; // support vertices the narrow phase ended on, where the test of the next tick starts
+	};
+
+	/**
+		\brief find the contact of a collider pair in contacts sorted by key, nullptr if the pair has none
+	*/
+	template <uint dims>
+	const Contact<dims>* find_contact(const std::vector<Contact<dims>>& contacts, const ContactKey& key)
+	{
+		auto found = std::lower_bound(contacts.begin(), contacts.end(), key, [](const Contact<dims>& lhs, const ContactKey& rhs) {
+			return lhs.key < rhs;
+		});
+		return found != contacts.end() && found->key == key ? &*found : nullptr;
+	}
+
+
+	/**
+		\brief first collider hit by a ray or shape cast
+	*/
+	template <uint dims>
+	struct RaycastHit
+	{
+		using position_type = decltype(Transform<dims>::translate);
+
+		Entity<dims>* entity;
+		uint collider; // index of the collider in entity
+		float distance; // distance along the ray
+		position_type point; // ray origin moved by distance, for shape casts the cast transform origin
+		position_type normal; // pointing away from the hit collider
+	};
+
+
+	using Contact2D = Contact<2>;
+	using Contact3D = Contact<3>;
+	using RaycastHit2D = RaycastHit<2>;
+	using RaycastHit3D = RaycastHit<3>;
+}
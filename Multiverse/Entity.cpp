@@ -1,5 +1,8 @@
 #include "MultiversePCH.h"
 #include "Entity.h"
+
+#include <algorithm> // max, min
+
 #include "Universe.h"
 #include "Component.h"
 
@@ -7,19 +10,33 @@
 template <mv::uint dims>
 mv::Entity<dims>::Entity(id_type id, id_type universe_id, const transform_type& transform, bool is_static)
 	: _id{ id }, _universe_id{ universe_id },
-	_transform_buffer{ transform }, _transform{ transform }, _velocity{},
-	_component_ids{}, _is_static{ is_static }
-
-{}
+	_transform{ transform }, _transform_state{ 0 }, _motion{ is_static ? nullptr : new Motion() },
+	_gridspace_cell_idx{ 0 }, _sleeping{ false }, _wide{ false },
+	_component_ids{}, _collision_layers{ 0 }, _continuous{ false }, _is_static{ is_static }
+{
+	if (this->_motion) {
+		this->_motion->buffer = transform;
+	}
+}
 
 template <mv::uint dims>
 mv::Entity<dims>::Entity(Entity&& other) noexcept
 	: _id{ other._id }, _universe_id{ other._universe_id },
-	_transform_buffer{ other._transform_buffer }, _transform{ other._transform }, _velocity{ other._velocity },
-	_component_ids{ std::move(other._component_ids) }, _is_static{ other._is_static }
+	_transform{ other._transform }, _transform_state{ other._transform_state.load() }, _motion{ other._motion },
+	_gridspace_cell_idx{ other._gridspace_cell_idx }, _sleeping{ other._sleeping.load() }, _wide{ other._wide },
+	_component_ids{ std::move(other._component_ids) },
+	_colliders{ std::move(other._colliders) }, _collision_layers{ other._collision_layers },
+	_continuous{ other._continuous }, _is_static{ other._is_static }
 {
 	other._id = invalid_id;
 	other._universe_id = invalid_id;
+	other._motion = nullptr;
+}
+
+template <mv::uint dims>
+mv::Entity<dims>::~Entity()
+{
+	delete this->_motion;
 }
 
 
@@ -30,13 +47,21 @@ mv::Entity<dims>& mv::Entity<dims>::operator=(Entity&& other) noexcept
 		return *this;
 	this->_id = other._id;
 	this->_universe_id = other._universe_id;
-	this->_transform_buffer = other._transform_buffer;
 	this->_transform = other._transform;
-	this->_velocity = other._velocity;
+	this->_transform_state = other._transform_state.load();
+	delete this->_motion;
+	this->_motion = other._motion;
+	this->_gridspace_cell_idx = other._gridspace_cell_idx;
+	this->_sleeping = other._sleeping.load();
+	this->_wide = other._wide;
 	this->_component_ids = std::move(other._component_ids);
+	this->_colliders = std::move(other._colliders);
+	this->_collision_layers = other._collision_layers;
+	this->_continuous = other._continuous;
 	this->_is_static = other._is_static;
 	other._id = invalid_id;
 	other._universe_id = invalid_id;
+	other._motion = nullptr;
 	return *this;
 }
 
@@ -63,13 +88,21 @@ mv::Universe<dims>& mv::Entity<dims>::universe() const
 template <mv::uint dims>
 const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::get_transform() const
 {
-	return this->universe()._transform_read_buffer ? this->_transform_buffer : this->_transform;
+	const Universe<dims>& universe = this->universe();
+	return universe._transform_read_buffer ? this->_snapshot_transform(universe._gridspace.tick()) : this->_latest_transform();
+}
+
+template <mv::uint dims>
+const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::get_snapshot_transform() const
+{
+	return this->_snapshot_transform(this->universe()._gridspace.tick());
 }
 
 template <mv::uint dims>
 const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::get_velocity() const
 {
-	return this->_velocity;
+	static const transform_type none{};
+	return this->_motion ? this->_motion->velocity : none;
 }
 
 template <mv::uint dims>
@@ -78,16 +111,24 @@ void mv::Entity<dims>::set_transform(const transform_type& transform)
 	if (this->_is_static) {
 		throw std::runtime_error("Entity::set_transform: static entities cannot be moved");
 	}
-	if (this->universe()._transform_readonly) {
+	Universe<dims>& universe = this->universe();
+	if (universe._transform_readonly) {
 		throw std::runtime_error("Entity::set_transform: transform is currently readonly");
 	}
-	this->_transform = transform;
+	this->_write_transform(transform);
+	this->_wake();
 }
 
 template <mv::uint dims>
 void mv::Entity<dims>::set_velocity(const transform_type& velocity)
 {
-	this->_velocity = velocity;
+	if (this->_is_static) {
+		throw std::runtime_error("Entity::set_velocity: static entities cannot be moved");
+	}
+	this->_motion->velocity = velocity;
+	// published before the sleep state is read by _wake, Gridspace::_sleep stores and reads them the other way around
+	this->_motion->has_velocity = !(velocity == transform_type{});
+	this->_wake();
 }
 
 
@@ -97,59 +138,229 @@ bool mv::Entity<dims>::is_static() const
 	return this->_is_static;
 }
 
+template <mv::uint dims>
+void mv::Entity<dims>::set_parent(Entity<dims>& parent, const transform_type& local)
+{
+	if (this->_is_static) {
+		throw std::runtime_error("Entity::set_parent: static entities cannot be moved");
+	}
+	if (parent._universe_id != this->_universe_id) {
+		throw std::runtime_error("Entity::set_parent: parent is in another universe");
+	}
+	if (parent._id == this->_id) {
+		throw std::runtime_error("Entity::set_parent: an entity cannot be its own parent");
+	}
+	TransformHierarchy<dims>& hierarchy = this->universe()._hierarchy;
+	if (!hierarchy.contains(parent._id)) {
+		hierarchy.add(parent._id, parent._latest_transform());
+	}
+	id_type old_parent_id{ invalid_id };
+	if (hierarchy.contains(this->_id)) {
+		old_parent_id = hierarchy.parent(this->_id);
+	}
+	else {
+		hierarchy.add(this->_id, local);
+	}
+	hierarchy.set_parent(this->_id, parent._id);
+	hierarchy.set_local(this->_id, local);
+	if (old_parent_id != invalid_id && old_parent_id != parent._id) {
+		hierarchy.prune(old_parent_id);
+	}
+}
+
+template <mv::uint dims>
+void mv::Entity<dims>::clear_parent()
+{
+	TransformHierarchy<dims>& hierarchy = this->universe()._hierarchy;
+	if (!hierarchy.contains(this->_id)) {
+		return;
+	}
+	id_type old_parent_id{ hierarchy.parent(this->_id) };
+	hierarchy.set_parent(this->_id, invalid_id);
+	hierarchy.set_local(this->_id, this->_latest_transform());
+	// neither node is kept as a tree of its own
+	hierarchy.prune(this->_id);
+	if (old_parent_id != invalid_id) {
+		hierarchy.prune(old_parent_id);
+	}
+}
+
+template <mv::uint dims>
+mv::Entity<dims>* mv::Entity<dims>::parent() const
+{
+	const TransformHierarchy<dims>& hierarchy = this->universe()._hierarchy;
+	if (!hierarchy.contains(this->_id) || hierarchy.parent(this->_id) == invalid_id) {
+		return nullptr;
+	}
+	return &mv::Multiverse::entity<dims>(hierarchy.parent(this->_id));
+}
+
+template <mv::uint dims>
+void mv::Entity<dims>::set_local_transform(const transform_type& local)
+{
+	TransformHierarchy<dims>& hierarchy = this->universe()._hierarchy;
+	if (!hierarchy.contains(this->_id) || hierarchy.parent(this->_id) == invalid_id) {
+		throw std::runtime_error("Entity::set_local_transform: entity has no parent");
+	}
+	hierarchy.set_local(this->_id, local);
+}
+
+
+template <mv::uint dims>
+bool mv::Entity<dims>::is_sleeping() const
+{
+	return this->_sleeping;
+}
+
 
 template <mv::uint dims>
 void mv::Entity<dims>::add_collider(const Collider<dims>& collider)
 {
 	this->_colliders.push_back(collider);
+	this->_collision_layers |= collision_layer_mask(collider.layer());
+	this->_continuous |= collider.is_continuous();
+	this->_update_placements(this->universe()._gridspace.tick());
+	this->universe()._gridspace.update_colliders(*this);
 }
 
 template <mv::uint dims>
 void mv::Entity<dims>::add_collider(Collider<dims>&& collider)
 {
 	this->_colliders.push_back(std::move(collider));
+	this->_collision_layers |= collision_layer_mask(this->_colliders.back().layer());
+	this->_continuous |= this->_colliders.back().is_continuous();
+	this->_update_placements(this->universe()._gridspace.tick());
+	this->universe()._gridspace.update_colliders(*this);
 }
 
-
 template <mv::uint dims>
-void mv::Entity<dims>::_solve_collision(Entity<dims>& other)
+mv::CollisionLayerMask mv::Entity<dims>::collision_layers() const
 {
-	if (this->_colliders.empty() || other._colliders.empty()) {
-		return;
-	}
+	return this->_collision_layers;
+}
 
+
+template <mv::uint dims>
+void mv::Entity<dims>::_queue_collision(Entity<dims>& other, const CollisionLayerMask* layer_interactions,
+	CollisionBatch<dims>& batch, std::vector<ContactKey>& keys, std::vector<byte>& sides)
+{
 	for (std::size_t i = 0; i < this->_colliders.size(); ++i) {
-		auto ta = this->_transform_buffer.transform_matrix();
 		for (std::size_t j = 0; j < other._colliders.size(); ++j) {
-			auto tb = other._transform_buffer.transform_matrix();
 			Collider<dims>& a = this->_colliders[i];
 			Collider<dims>& b = other._colliders[j];
+			if (!(layer_interactions[static_cast<byte>(a.layer())] & collision_layer_mask(b.layer()))) {
+				continue;
+			}
 			CollisionResponse response_ab = a.response(b.layer());
 			CollisionResponse response_ba = b.response(a.layer());
 			if (response_ab == CollisionResponse::ignore || response_ba == CollisionResponse::ignore) {
 				continue;
 			}
+			if (!a._placement.overlaps(b._placement)) {
+				continue;
+			}
+			// overlaps go through the narrow phase as well, so events only fire once the shapes themselves touch
+			batch.add(a._shape, a._placement, b._shape, b._placement);
 			if (response_ab == CollisionResponse::block && response_ba == CollisionResponse::block) {
-				position_type mtv;
-				a._shape.collides(b._shape, ta, tb, mtv);
-				if (!other.is_static()) {
-					mtv *= 0.5f;
-					other._transform.translate -= mtv;
-				}
-				this->_transform.translate += mtv;
+				keys.push_back(ContactKey{ this->id(), other.id(), static_cast<uint>(i), static_cast<uint>(j) });
+				sides.push_back(0);
 			}
 			else {
-				if (response_ab == CollisionResponse::overlap) {
-					a._overlaps.insert(other.id());
+				byte pair_sides = static_cast<byte>((response_ab == CollisionResponse::overlap ? 0b01u : 0u) |
+					(response_ba == CollisionResponse::overlap ? 0b10u : 0u));
+				if (this->id() < other.id()) {
+					keys.push_back(ContactKey{ this->id(), other.id(), static_cast<uint>(i), static_cast<uint>(j) });
 				}
-				if (response_ba == CollisionResponse::overlap) {
-					b._overlaps.insert(this->id());
+				else {
+					keys.push_back(ContactKey{ other.id(), this->id(), static_cast<uint>(j), static_cast<uint>(i) });
+					pair_sides = static_cast<byte>(((pair_sides & 0b01u) << 1) | ((pair_sides & 0b10u) >> 1));
 				}
+				sides.push_back(pair_sides);
+			}
+		}
+	}
+}
+
+template <mv::uint dims>
+mv::CollisionLayerMask mv::Entity<dims>::_interaction_layers(const CollisionLayerMask* layer_interactions) const
+{
+	CollisionLayerMask layers = 0;
+	for (const Collider<dims>& collider : this->_colliders) {
+		layers |= collider.response_layers() & layer_interactions[static_cast<byte>(collider.layer())];
+	}
+	return layers;
+}
+
+template <mv::uint dims>
+void mv::Entity<dims>::_sweep_collision(const Entity<dims>& other, const CollisionLayerMask* layer_interactions,
+	const std::vector<Contact<dims>>& contacts, float& toi) const
+{
+	position_type sweep{ this->_sweep() }, other_sweep{ other._sweep() };
+	for (std::size_t i = 0; i < this->_colliders.size(); ++i) {
+		const Collider<dims>& a = this->_colliders[i];
+		if (!a._continuous) {
+			continue;
+		}
+		// bounds covered by the whole movement
+		auto start = a._placement.translated(-sweep);
+		auto swept = a._placement;
+		for (uint d = 0; d < dims; ++d) {
+			swept.lower[d] = std::min(swept.lower[d], start.lower[d]);
+			swept.upper[d] = std::max(swept.upper[d], start.upper[d]);
+		}
+		for (std::size_t j = 0; j < other._colliders.size(); ++j) {
+			const Collider<dims>& b = other._colliders[j];
+			if (!(layer_interactions[static_cast<byte>(a.layer())] & collision_layer_mask(b.layer())) ||
+				a.response(b.layer()) != CollisionResponse::block || b.response(a.layer()) != CollisionResponse::block) {
+				continue;
+			}
+			auto other_start = b._placement.translated(-other_sweep);
+			auto other_swept = b._placement;
+			for (uint d = 0; d < dims; ++d) {
+				other_swept.lower[d] = std::min(other_swept.lower[d], other_start.lower[d]);
+				other_swept.upper[d] = std::max(other_swept.upper[d], other_start.upper[d]);
+			}
+			if (!swept.overlaps(other_swept)) {
+				continue;
+			}
+			const Contact<dims>* cached = find_contact(contacts, ContactKey{ this->_id, other._id, static_cast<uint>(i), static_cast<uint>(j) });
+			SupportHints hints{ cached ? cached->hints : SupportHints{ 0, 0 } };
+			float pair_toi;
+			position_type normal;
+			if (a._shape.time_of_impact(b._shape, start, sweep, other_start, other_sweep, pair_toi, normal, hints) && pair_toi < toi) {
+				toi = pair_toi;
 			}
 		}
 	}
 }
 
+template <mv::uint dims>
+void mv::Entity<dims>::_update_placements(uint tick)
+{
+	if (this->_colliders.empty()) {
+		return;
+	}
+	const transform_type& snapshot = this->_snapshot_transform(tick);
+	// static entities are placed once, so only moving entities keep the trig around
+	typename transform_type::Trig placed_trig{};
+	typename transform_type::Trig& trig = this->_motion ? this->_motion->trig : placed_trig;
+	snapshot.update_trig(trig);
+	auto transform = snapshot.transform_matrix(trig);
+	auto inverse = snapshot.inverse_transform_matrix(trig);
+	for (Collider<dims>& collider : this->_colliders) {
+		collider._placement = collider._shape.place(transform, inverse);
+	}
+}
+
+
+template <mv::uint dims>
+void mv::Entity<dims>::_wake()
+{
+	if (!this->_is_static) {
+		this->universe()._gridspace.wake(*this);
+	}
+}
+
 
 template class mv::Entity<2>;
 template class mv::Entity<3>;
@@ -1,8 +1,10 @@
 #pragma once
 #include "setup.h"
 
+#include <atomic> // atomic
 #include <iterator> // iterator, random_access_iterator_tag
 #include <map> // map
+#include <stdexcept> // logic_error
 #include <type_traits> // enable_if, is_base_of
 #include <vector> // vector
 
@@ -10,6 +12,8 @@
 #include "Multiverse.h"
 #include "Transform.h"
 #include "Collider.h"
+#include "CollisionBatch.h"
+#include "Contact.h"
 
 namespace mv
 {
@@ -94,17 +98,36 @@ namespace mv
 		};
 
 
+		/**
+			\brief state only entities that move need, static entities never allocate it
+		*/
+		struct Motion
+		{
+			transform_type buffer; // slot 1 of the transform, see _write_transform
+			typename transform_type::Trig trig; // of the transform colliders were last placed at, written by _update_placements only
+			transform_type velocity;
+			std::atomic<bool> has_velocity{ false }; // velocity is not zero, read by the gridspace while components may set the velocity
+			uint rest_ticks{ 0 }; // consecutive updates without movement
+			position_type sweep; // movement in the last gridspace update, continuous colliders are swept along it
+		};
+
+
 		id_type _id; // id of this entity, unique in the multiverse
 		id_type _universe_id; // id of the universe in which the entity resides
 
-		transform_type _transform_buffer;
-		transform_type _transform;
-		transform_type _velocity;
+		// the latest transform and the snapshot taken at the last gridspace update are slots 0 and 1, see _write_transform
+		transform_type _transform; // slot 0, the only slot of static entities
+		std::atomic<uint> _transform_state; // slot of the latest transform in the lowest bit, gridspace tick of its last write above
+		Motion* _motion; // nullptr for static entities
 		uint _gridspace_cell_idx;
+		std::atomic<bool> _sleeping; // tested without the wake lock, see Gridspace::wake
+		bool _wide; // static entity with a collider wider than a cell, kept in no cell by the gridspace
 
 		std::map<type_id_type, std::vector<id_type>> _component_ids; // unique ids of attached components per component type
 
 		std::vector<Collider<dims>> _colliders;
+		CollisionLayerMask _collision_layers; // layers of all colliders
+		bool _continuous; // whether any collider is continuous
 		bool _is_static;
 
 
@@ -114,6 +137,8 @@ namespace mv
 		Entity(const Entity&) = delete;
 		Entity(Entity&& other) noexcept;
 
+		~Entity();
+
 		Entity& operator=(const Entity&) = delete;
 		Entity& operator=(Entity&& other) noexcept;
 
@@ -131,12 +156,42 @@ namespace mv
 		Universe<dims>& universe() const;
 
 		const transform_type& get_transform() const;
+		/**
+			\brief get the transform at the last gridspace update
+
+			Writes after the gridspace update go to the other slot, so the snapshot stays the same until the next one,
+			for renderers, replication or interpolation that want a consistent state of the previous tick.
+		*/
+		const transform_type& get_snapshot_transform() const;
 		const transform_type& get_velocity() const;
 		void set_transform(const transform_type& transform);
 		void set_velocity(const transform_type& velocity);
 
 		bool is_static() const;
 
+		/**
+			\brief attach this entity to a parent entity of the same universe
+			\param local transform relative to the parent
+
+			At the end of every update the transform of a child is set from the transform of its parent and its local
+			transform. A child moved with set_transform or pushed by collisions keeps its new place, its local transform
+			is derived again relative to the transform its parent had at the end of the previous update. Throws for
+			static entities and if the parent is this entity or one of its children.
+		*/
+		void set_parent(Entity<dims>& parent, const transform_type& local);
+		/**
+			\brief detach this entity from its parent, it keeps its current transform
+		*/
+		void clear_parent();
+		/**
+			\brief get the parent entity, nullptr if the entity has no parent
+		*/
+		Entity<dims>* parent() const;
+		/**
+			\brief set the transform relative to the parent, applied at the end of the next update
+		*/
+		void set_local_transform(const transform_type& local);
+
 		/**
 			\brief get component of type
 			\returns an attached component of the specified type, nullptr if not found
@@ -169,9 +224,82 @@ namespace mv
 
 		void add_collider(const Collider<dims>& collider);
 		void add_collider(Collider<dims>&& collider);
+		/**
+			\brief get mask of the layers of all attached colliders
+		*/
+		CollisionLayerMask collision_layers() const;
+
+		/**
+			\brief check whether the entity is asleep
+
+			Dynamic entities that have not moved for MV_SLEEP_TICKS updates are put to sleep, they are skipped by
+			the gridspace update and only collided against. Setting the transform or velocity or being pushed wakes them up.
+		*/
+		bool is_sleeping() const;
 
 	private:
-		void _solve_collision(Entity<dims>& other);
+		/**
+			\brief queue the pairs between the colliders of this and other whose bounds overlap in batch
+			\param layer_interactions layers each layer may interact with, indexed by CollisionLayer
+			\param keys receives the collider pair of each queued pair
+			\param sides receives the colliders to raise overlap events on for each queued pair, 0 for blocking pairs
+		*/
+		void _queue_collision(Entity<dims>& other, const CollisionLayerMask* layer_interactions,
+			CollisionBatch<dims>& batch, std::vector<ContactKey>& keys, std::vector<byte>& sides);
+		/**
+			\brief get mask of the layers any collider may interact with, given the layer interactions of the universe
+		*/
+		CollisionLayerMask _interaction_layers(const CollisionLayerMask* layer_interactions) const;
+		/**
+			\brief sweep the continuous colliders of this back along the last movement against the colliders of other
+			\param contacts contacts of the last update sorted by key, pairs in contact start their support searches at its hints
+			\param toi lowered to the fraction of the movement at which a blocking collider is first touched
+		*/
+		void _sweep_collision(const Entity<dims>& other, const CollisionLayerMask* layer_interactions,
+			const std::vector<Contact<dims>>& contacts, float& toi) const;
+		/**
+			\brief place the colliders at the snapshot of tick
+		*/
+		void _update_placements(uint tick);
+		void _wake();
+
+		/**
+			\brief get a slot of the transform, static entities only have slot 0
+		*/
+		transform_type& _slot(uint slot);
+		const transform_type& _slot(uint slot) const;
+		/**
+			\brief get the movement in the last gridspace update, zero for static entities
+		*/
+		position_type _sweep() const;
+
+		const transform_type& _latest_transform() const;
+		/**
+			\brief get the transform at the start of tick, the latest transform if it was not written since
+		*/
+		const transform_type& _snapshot_transform(uint tick) const;
+		/**
+			\brief check whether the transform was written in tick
+		*/
+		bool _written_in(uint tick) const;
+		/**
+			\brief set the latest transform in the current gridspace tick
+
+			The first write in a tick goes to the slot not holding the snapshot, later writes in the same tick use that
+			slot directly. Advancing the tick thus snapshots every entity without copies. Slot and tick are published
+			together after the transform is written, so a reader never pairs a slot with the wrong tick.
+			Writes are only allowed while the cells are not being updated, they read the latest transforms in place.
+		*/
+		void _write_transform(const transform_type& transform);
+		/**
+			\brief move the latest transform by offset, the rest of it is kept, see _write_transform
+		*/
+		void _move_transform(const position_type& offset);
+		/**
+			\brief get the state to publish for a write in the current tick, the slot to write is in its lowest bit
+			\param keep whether the slot has to start out as the latest transform
+		*/
+		uint _begin_transform_write(bool keep);
 	};
 
 	template <uint dims, typename ComponentType>
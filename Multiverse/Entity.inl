@@ -262,6 +262,86 @@ inline bool mv::Entity<dims>::remove_component(id_type component_id)
 
 
 
+template <mv::uint dims>
+inline typename mv::Entity<dims>::transform_type& mv::Entity<dims>::_slot(uint slot)
+{
+	// static entities are never written, so slot 0 is both their latest transform and their snapshot
+	return slot && this->_motion ? this->_motion->buffer : this->_transform;
+}
+
+template <mv::uint dims>
+inline const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::_slot(uint slot) const
+{
+	return slot && this->_motion ? this->_motion->buffer : this->_transform;
+}
+
+template <mv::uint dims>
+inline typename mv::Entity<dims>::position_type mv::Entity<dims>::_sweep() const
+{
+	return this->_motion ? this->_motion->sweep : position_type{};
+}
+
+template <mv::uint dims>
+inline const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::_latest_transform() const
+{
+	return this->_slot(this->_transform_state.load(std::memory_order_acquire) & 1u);
+}
+
+template <mv::uint dims>
+inline const typename mv::Entity<dims>::transform_type& mv::Entity<dims>::_snapshot_transform(uint tick) const
+{
+	// slot and tick come from one load, so they always belong to the same write
+	uint state = this->_transform_state.load(std::memory_order_acquire);
+	return this->_slot((state & ~1u) == tick << 1 ? (state & 1u) ^ 1u : state & 1u);
+}
+
+template <mv::uint dims>
+inline bool mv::Entity<dims>::_written_in(uint tick) const
+{
+	return (this->_transform_state.load(std::memory_order_acquire) & ~1u) == tick << 1;
+}
+
+template <mv::uint dims>
+inline void mv::Entity<dims>::_write_transform(const transform_type& transform)
+{
+	uint state = this->_begin_transform_write(false);
+	this->_slot(state & 1u) = transform;
+	this->_transform_state.store(state, std::memory_order_release);
+}
+
+template <mv::uint dims>
+inline void mv::Entity<dims>::_move_transform(const position_type& offset)
+{
+	uint state = this->_begin_transform_write(true);
+	this->_slot(state & 1u).translate += offset;
+	this->_transform_state.store(state, std::memory_order_release);
+}
+
+template <mv::uint dims>
+inline mv::uint mv::Entity<dims>::_begin_transform_write(bool keep)
+{
+	const Universe<dims>& universe = this->universe();
+#ifdef _DEBUG
+	// components read the snapshot while the collision update writes, but while the cells are updated nothing may
+	if (universe._transform_readonly && !universe._transform_read_buffer) {
+		throw std::logic_error("Entity::_write_transform: transform written while the cells read the latest transforms");
+	}
+#endif
+	// only the owner of an entity in the current phase writes it, so the state it loads cannot change meanwhile
+	uint state = this->_transform_state.load(std::memory_order_relaxed);
+	uint written = universe._gridspace.tick() << 1;
+	if ((state & ~1u) == written) {
+		return state;
+	}
+	uint slot = (state & 1u) ^ 1u;
+	if (keep) {
+		this->_slot(slot) = this->_slot(slot ^ 1u);
+	}
+	return written | slot;
+}
+
+
+
 
 template <mv::uint dims, typename ComponentType>
 typename mv::Entity<dims>::template ComponentIterator<ComponentType> mv::operator+(
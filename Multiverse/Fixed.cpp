@@ -0,0 +1,136 @@
+#include "MultiversePCH.h"
+#include "Fixed.h"
+
+#include <cmath>	// cos, sin
+
+
+namespace
+{
+	constexpr mv::uint32 quarter_table_bits = 8;
+	constexpr mv::uint32 quarter_table_size = 1u << quarter_table_bits; // intervals per quarter turn
+	constexpr mv::uint32 quarter_turn = 1u << 30; // phases are fractions of a turn in 32 bits
+
+	/**
+		\brief sine of the first quarter wave in Q16.16
+
+		Computed at compile time from a Taylor series, so the table does not depend on the standard library of the machine.
+	*/
+	struct QuarterSineTable
+	{
+		mv::int32 values[quarter_table_size + 1];
+
+		constexpr QuarterSineTable()
+			: values{}
+		{
+			for (mv::uint32 i = 0; i <= quarter_table_size; ++i) {
+				double x = 1.5707963267948966 * static_cast<double>(i) / static_cast<double>(quarter_table_size);
+				double term = x;
+				double sum = x;
+				for (int n = 1; n < 14; ++n) {
+					term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+					sum += term;
+				}
+				this->values[i] = static_cast<mv::int32>(sum * static_cast<double>(mv::Fixed::one) + 0.5);
+			}
+		}
+	};
+
+	constexpr QuarterSineTable quarter_sine{};
+
+	/**
+		\brief sine at phase within the first quarter, phase in [0, quarter_turn]
+	*/
+	mv::int32 quarter_wave(mv::uint32 phase)
+	{
+		mv::uint32 i = phase >> (30 - quarter_table_bits);
+		if (i >= quarter_table_size) {
+			return quarter_sine.values[quarter_table_size];
+		}
+		mv::int64 fraction = (phase >> (30 - quarter_table_bits - 16)) & 0xFFFF;
+		mv::int64 delta = quarter_sine.values[i + 1] - quarter_sine.values[i];
+		return quarter_sine.values[i] + static_cast<mv::int32>((delta * fraction) >> 16);
+	}
+
+	/**
+		\brief sine at phase, a fraction of a full turn in 32 bits
+	*/
+	mv::Fixed phase_sine(mv::uint32 phase)
+	{
+		mv::uint32 offset = phase & (quarter_turn - 1);
+		switch (phase >> 30) {
+		case 0:
+			return mv::Fixed::from_raw(quarter_wave(offset));
+		case 1:
+			return mv::Fixed::from_raw(quarter_wave(quarter_turn - offset));
+		case 2:
+			return mv::Fixed::from_raw(-quarter_wave(offset));
+		default:
+			return mv::Fixed::from_raw(-quarter_wave(quarter_turn - offset));
+		}
+	}
+
+	/**
+		\brief convert radians to a phase, wrapping around full turns
+	*/
+	mv::uint32 phase(mv::Fixed x)
+	{
+		// 2^32 / (2 pi) phase units per radian, x is scaled by 2^16
+		return static_cast<mv::uint32>((static_cast<mv::int64>(x.raw()) * 683565276ll) >> 16);
+	}
+}
+
+
+
+mv::Fixed mv::sqrt(Fixed x)
+{
+	if (x.raw() <= 0) {
+		return Fixed{};
+	}
+	// integer square root of raw * 2^16, one result bit at a time
+	uint64 value = static_cast<uint64>(x.raw()) << Fixed::fraction_bits;
+	uint64 result = 0;
+	uint64 bit = uint64{ 1 } << 62;
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return Fixed::from_raw(static_cast<Fixed::raw_type>(result));
+}
+
+mv::Fixed mv::sin(Fixed x)
+{
+	return phase_sine(phase(x));
+}
+
+mv::Fixed mv::cos(Fixed x)
+{
+	return phase_sine(phase(x) + quarter_turn);
+}
+
+
+float mv::angle_cos(float angle)
+{
+#if MV_FIXED_POINT_TRIG
+	return static_cast<float>(cos(Fixed{ angle }));
+#else
+	return std::cos(angle);
+#endif
+}
+
+float mv::angle_sin(float angle)
+{
+#if MV_FIXED_POINT_TRIG
+	return static_cast<float>(sin(Fixed{ angle }));
+#else
+	return std::sin(angle);
+#endif
+}
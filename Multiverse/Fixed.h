@@ -0,0 +1,88 @@
+#pragma once
+#include "setup.h"
+
+#include <limits>
+
+namespace mv
+{
+	/**
+		\brief signed Q16.16 fixed point number
+
+		All arithmetic is integer arithmetic, so results are bit-identical on every compiler and instruction set.
+		Multiplication and division round towards negative infinity and zero respectively, overflow wraps.
+		Division by zero saturates to the largest value of the sign of the dividend, zero divided by zero is zero.
+		Vector<Fixed, N> and Matrix<Fixed, R, C> find abs, sqrt, sin and cos by argument dependent lookup, FixedTests
+		instantiates them. The simulation itself still runs on float.
+	*/
+	class Fixed
+	{
+	public:
+		using raw_type = int32;
+		static constexpr int fraction_bits = 16;
+		static constexpr raw_type one = raw_type{ 1 } << fraction_bits;
+
+	private:
+		raw_type _raw;
+
+	public:
+		constexpr Fixed() : _raw{ 0 } {}
+		constexpr Fixed(int value) : _raw{ static_cast<raw_type>(static_cast<uint32>(value) << fraction_bits) } {}
+		constexpr explicit Fixed(float value) : _raw{ static_cast<raw_type>(value * static_cast<float>(one) + (value < 0.f ? -0.5f : 0.5f)) } {}
+		constexpr explicit Fixed(double value) : _raw{ static_cast<raw_type>(value * static_cast<double>(one) + (value < 0. ? -0.5 : 0.5)) } {}
+
+		/**
+			\brief create a fixed point number from its raw representation, the value times 2^16
+		*/
+		static constexpr Fixed from_raw(raw_type raw) { Fixed f; f._raw = raw; return f; }
+		constexpr raw_type raw() const { return this->_raw; }
+
+		constexpr explicit operator float() const { return static_cast<float>(this->_raw) / static_cast<float>(one); }
+		constexpr explicit operator double() const { return static_cast<double>(this->_raw) / static_cast<double>(one); }
+		constexpr explicit operator int() const { return this->_raw >> fraction_bits; }
+
+		constexpr Fixed operator-() const { return from_raw(-this->_raw); }
+		constexpr Fixed operator+(Fixed rhs) const { return from_raw(this->_raw + rhs._raw); }
+		constexpr Fixed operator-(Fixed rhs) const { return from_raw(this->_raw - rhs._raw); }
+		constexpr Fixed operator*(Fixed rhs) const { return from_raw(static_cast<raw_type>((static_cast<int64>(this->_raw) * rhs._raw) >> fraction_bits)); }
+		constexpr Fixed operator/(Fixed rhs) const
+		{
+			return rhs._raw != 0 ? from_raw(static_cast<raw_type>((static_cast<int64>(this->_raw) * one) / rhs._raw)) :
+				from_raw(this->_raw > 0 ? std::numeric_limits<raw_type>::max() : this->_raw < 0 ? std::numeric_limits<raw_type>::min() : 0);
+		}
+
+		constexpr Fixed& operator+=(Fixed rhs) { return *this = *this + rhs; }
+		constexpr Fixed& operator-=(Fixed rhs) { return *this = *this - rhs; }
+		constexpr Fixed& operator*=(Fixed rhs) { return *this = *this * rhs; }
+		constexpr Fixed& operator/=(Fixed rhs) { return *this = *this / rhs; }
+
+		constexpr bool operator==(Fixed rhs) const { return this->_raw == rhs._raw; }
+		constexpr bool operator!=(Fixed rhs) const { return this->_raw != rhs._raw; }
+		constexpr bool operator<(Fixed rhs) const { return this->_raw < rhs._raw; }
+		constexpr bool operator>(Fixed rhs) const { return this->_raw > rhs._raw; }
+		constexpr bool operator<=(Fixed rhs) const { return this->_raw <= rhs._raw; }
+		constexpr bool operator>=(Fixed rhs) const { return this->_raw >= rhs._raw; }
+	};
+
+	constexpr Fixed abs(Fixed x) { return x < Fixed{} ? -x : x; }
+	/**
+		\brief square root, rounded down, 0 for negative x
+	*/
+	Fixed sqrt(Fixed x);
+	/**
+		\brief sine of x radians, from a quarter wave table with linear interpolation, accurate to about 2e-5
+	*/
+	Fixed sin(Fixed x);
+	/**
+		\brief cosine of x radians, from the same table as sin
+	*/
+	Fixed cos(Fixed x);
+
+	/**
+		\brief cosine and sine of a float angle
+
+		Transforms and shapes get their rotations from these. When MV_FIXED_POINT_TRIG is enabled the angle goes through the
+		fixed point table, so the sine and cosine no longer depend on the standard library; the rest of the math stays float.
+	*/
+	float angle_cos(float angle);
+	float angle_sin(float angle);
+}
@@ -0,0 +1,57 @@
+#include "MultiversePCH.h"
+#include <catch.hpp>
+#include "Fixed.h"
+#include "Vector.h"
+#include "Matrix.h"
+
+using namespace mv;
+
+// every member that does not depend on further template arguments has to compile with Fixed elements
+template class mv::Vector<Fixed, 2>;
+template class mv::Vector<Fixed, 3>;
+template class mv::Matrix<Fixed, 3, 3>;
+template class mv::Matrix<Fixed, 4, 4>;
+
+TEST_CASE("Fixed point arithmetic", "Fixed")
+{
+	REQUIRE(Fixed{ 3 } + Fixed{ 0.5f } == Fixed{ 3.5f });
+	REQUIRE(Fixed{ 1.5f } * Fixed{ -2 } == Fixed{ -3 });
+	REQUIRE(Fixed{ 7 } / Fixed{ 2 } == Fixed{ 3.5f });
+	REQUIRE(static_cast<float>(sqrt(Fixed{ 2 })) == Approx(1.41421f).margin(1e-4f));
+	REQUIRE(static_cast<float>(sin(Fixed{ 0.5f })) == Approx(std::sin(0.5f)).margin(1e-4f));
+	REQUIRE(static_cast<float>(cos(Fixed{ -2.f })) == Approx(std::cos(-2.f)).margin(1e-4f));
+}
+
+TEST_CASE("Fixed point division by zero saturates", "Fixed")
+{
+	REQUIRE((Fixed{ 5 } / Fixed{}).raw() == std::numeric_limits<Fixed::raw_type>::max());
+	REQUIRE((Fixed{ -5 } / Fixed{}).raw() == std::numeric_limits<Fixed::raw_type>::min());
+	REQUIRE(Fixed{} / Fixed{} == Fixed{});
+}
+
+TEST_CASE("Fixed point vectors and matrices", "Fixed")
+{
+	Vector<Fixed, 2> v{ Fixed{ 3 }, Fixed{ 4 } };
+	REQUIRE(v.magnitude() == 5.);
+
+	// rotations take their trigonometry from the fixed point table
+	Matrix<Fixed, 3, 3> m{ Matrix<Fixed, 3, 3>::transform(Vector<Fixed, 2>{ Fixed{ 1 }, Fixed{ 2 } }, 0.5, Vector<Fixed, 2>{ Fixed{ 2 }, Fixed{ 2 } }) };
+	mat3f f{ mat3f::transform(vec2f{ 1.f, 2.f }, 0.5f, vec2f{ 2.f, 2.f }) };
+	Matrix<Fixed, 3, 3> m_inverse{ m.inverse() };
+	Matrix<Fixed, 4, 4> r{ Matrix<Fixed, 4, 4>::rotate(0.5, Vector<Fixed, 3>{ Fixed{}, Fixed{}, Fixed{ 1 } }) };
+	for (unsigned int i{ 0 }; i < 3; ++i) {
+		for (unsigned int j{ 0 }; j < 3; ++j) {
+			REQUIRE(static_cast<float>(m[i][j]) == Approx(f[i][j]).margin(1e-3f));
+			REQUIRE(static_cast<float>(m_inverse[i][j]) == Approx(f.inverse()[i][j]).margin(1e-3f));
+			REQUIRE(static_cast<float>(r[i][j]) == Approx(mat4f::rotate(0.5, vec3f{ 0.f, 0.f, 1.f })[i][j]).margin(1e-3f));
+		}
+	}
+
+	// larger matrices are inverted by Gauss-Jordan elimination, which picks pivots by abs
+	Matrix<Fixed, 5, 5> d{ Matrix<Fixed, 5, 5>::identity() };
+	d[2][2] = Fixed{ 4 };
+	d[3][2] = Fixed{ -2 };
+	Matrix<Fixed, 5, 5> d_inverse{ d.inverse() };
+	REQUIRE(d_inverse[2][2] == Fixed{ 0.25f });
+	REQUIRE(d_inverse[3][2] == Fixed{ 0.5f });
+}
@@ -9,9 +9,10 @@
 #pragma once
 #include "setup.h"
 #include "Vector.h" // Vector
+#include "Simd.h" // simd kernels
 
 #include <cstddef>	// nullptr_t
-#include <type_traits> // enable_if
+#include <type_traits> // enable_if, integral_constant, is_same
 #include <ostream> // ostream
 #include <utility> // declval
 
@@ -283,7 +284,7 @@ namespace mv
 
 		/**
 			\brief calculate determinant
-			\complexity exponential in matrix size
+			\complexity constant up to 4x4, exponential in matrix size above that
 
 			square matrix types only
 			calculates the determinant of the matrix
@@ -303,9 +304,28 @@ namespace mv
 		*/
 		const Matrix<T, C, R, static_cast<bool>(!static_cast<bool>(D))>& transpose() const;
 
+		/**
+			\brief matrix inverse
+			\complexity constant up to 4x4, cubic in matrix size above that
+
+			square matrix types only
+			2x2, 3x3 and 4x4 matrices are inverted with their closed form adjugate,
+			larger matrices with Gauss-Jordan elimination
+		*/
 		template <unsigned int _R = R, unsigned int _C = C>
 		typename std::enable_if<_R == _C, Matrix<T, R, C, D>>::type inverse() const;
 
+		/**
+			\brief affine matrix inverse
+
+			square matrix types only
+			inverts an affine transformation of column vectors, i.e. a matrix with a last row of 0, ..., 0, 1,
+			by inverting the linear part and transforming the negated translation with it
+			this is considerably cheaper than inverse(), the result is undefined for matrices that are not affine
+		*/
+		template <unsigned int _R = R, unsigned int _C = C>
+		typename std::enable_if<_R == _C && (_R > 1), Matrix<T, R, C, D>>::type affine_inverse() const;
+
 		template <typename _T, bool _D>
 		bool operator==(const Matrix<_T, R, C, _D>& rhs) const;
 		template <typename _T, bool _D>
@@ -349,6 +369,20 @@ namespace mv
 	private:
 		template <unsigned int _R = row_count, unsigned int _C = column_count>
 		static typename std::enable_if<_R == _C, Matrix<T, R, C, D>>::type _cache_init_identity();
+
+		// determinant and inverse by matrix size, closed forms for small sizes and a generic fallback.
+		// None of them are constexpr: elements are written through _elements and read through _vectors of the storage
+		// union, or the other way round, and constant evaluation rejects reading a union member that is not active
+		value_type _determinant(std::integral_constant<unsigned int, 2>) const;
+		value_type _determinant(std::integral_constant<unsigned int, 3>) const;
+		value_type _determinant(std::integral_constant<unsigned int, 4>) const;
+		template <unsigned int N>
+		value_type _determinant(std::integral_constant<unsigned int, N>) const;
+		Matrix<T, R, C, D> _inverse(std::integral_constant<unsigned int, 2>) const;
+		Matrix<T, R, C, D> _inverse(std::integral_constant<unsigned int, 3>) const;
+		Matrix<T, R, C, D> _inverse(std::integral_constant<unsigned int, 4>) const;
+		template <unsigned int N>
+		Matrix<T, R, C, D> _inverse(std::integral_constant<unsigned int, N>) const;
 	};
 
 	template <typename _T, typename T, unsigned int R, unsigned int C, bool D>
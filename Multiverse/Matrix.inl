@@ -155,8 +155,12 @@ typename std::enable_if<_R == 3 && _C == 3, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(angle) };
-	double sina{ std::sin(angle) };
+	// trigonometry in the precision of the elements, so float matrices do not pay for double precision,
+	// other element types such as Fixed provide their own by argument dependent lookup
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(angle))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(angle))) };
 	if (_D == D) {
 		return {
 			cosa  , sina  , T{ 0 },
@@ -181,13 +185,16 @@ typename std::enable_if<_R == 4 && _C == 4, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(angle) };
-	double sina{ std::sin(angle) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(angle))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(angle))) };
+	T versa{ T{ 1 } - cosa };
 	return {
-		cosa + r.x() * r.x() * (1 - cosa)        , r.y() * r.x() * (1 - cosa) + r.z() * sina, r.z() * r.x() * (1 - cosa) - r.y() * sina, T{ 0 },
-		r.x() * r.y() * (1 - cosa) - r.z() * sina, cosa + r.y() * r.y() * (1 - cosa)        , r.z() * r.y() * (1 - cosa) + r.x() * sina, T{ 0 },
-		r.x() * r.z() * (1 - cosa) + r.y() * sina, r.y() * r.z() * (1 - cosa) - r.x() * sina, cosa + r.z() * r.z() * (1 - cosa)        , T{ 0 },
-		T{ 0 }                                   , T{ 0 }                                   , T{ 0 }                                   , T{ 1 }
+		cosa + r.x() * r.x() * versa        , r.y() * r.x() * versa + r.z() * sina, r.z() * r.x() * versa - r.y() * sina, T{ 0 },
+		r.x() * r.y() * versa - r.z() * sina, cosa + r.y() * r.y() * versa        , r.z() * r.y() * versa + r.x() * sina, T{ 0 },
+		r.x() * r.z() * versa + r.y() * sina, r.y() * r.z() * versa - r.x() * sina, cosa + r.z() * r.z() * versa        , T{ 0 },
+		T{ 0 }                              , T{ 0 }                              , T{ 0 }                              , T{ 1 }
 	};
 }
 
@@ -199,13 +206,16 @@ typename std::enable_if<_R == 4 && _C == 4, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(angle) };
-	double sina{ std::sin(angle) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(angle))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(angle))) };
+	T versa{ T{ 1 } - cosa };
 	return {
-		cosa + r.x() * r.x() * (1 - cosa)        , r.x() * r.y() * (1 - cosa) - r.z() * sina, r.x() * r.z() * (1 - cosa) + r.y() * sina, T{ 0 },
-		r.y() * r.x() * (1 - cosa) + r.z() * sina, cosa + r.y() * r.y() * (1 - cosa)        , r.y() * r.z() * (1 - cosa) - r.x() * sina, T{ 0 },
-		r.z() * r.x() * (1 - cosa) - r.y() * sina, r.z() * r.y() * (1 - cosa) + r.x() * sina, cosa + r.z() * r.z() * (1 - cosa)        , T{ 0 },
-		T{ 0 }                                   , T{ 0 }                                   , T{ 0 }                                   , T{ 1 }
+		cosa + r.x() * r.x() * versa        , r.x() * r.y() * versa - r.z() * sina, r.x() * r.z() * versa + r.y() * sina, T{ 0 },
+		r.y() * r.x() * versa + r.z() * sina, cosa + r.y() * r.y() * versa        , r.y() * r.z() * versa - r.x() * sina, T{ 0 },
+		r.z() * r.x() * versa - r.y() * sina, r.z() * r.y() * versa + r.x() * sina, cosa + r.z() * r.z() * versa        , T{ 0 },
+		T{ 0 }                              , T{ 0 }                              , T{ 0 }                              , T{ 1 }
 	};
 }
 
@@ -219,8 +229,10 @@ typename std::enable_if<_R == _C && _R >= 3, mv::Matrix<T, R, C, D>>::type mv::M
 	static_assert(false, "not implemented");
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(angle) };
-	double sina{ std::sin(angle) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(angle))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(angle))) };
 	mv::Matrix<T, R, C, D> retval{};
 	return retval;
 }
@@ -235,8 +247,10 @@ typename std::enable_if<_R == 3 && _C == 3, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(a) };
-	double sina{ std::sin(a) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(a))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(a))) };
 	return {
 		s.x() * cosa , s.x() * sina, T{ 0 },
 		s.y() * -sina, s.y() * cosa, T{ 0 },
@@ -253,8 +267,10 @@ typename std::enable_if<_R == 3 && _C == 3, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(a) };
-	double sina{ std::sin(a) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(a))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(a))) };
 	return {
 		s * cosa , s * sina, T{ 0 },
 		s * -sina, s * cosa, T{ 0 },
@@ -271,8 +287,10 @@ typename std::enable_if<_R == 3 && _C == 3, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(a) };
-	double sina{ std::sin(a) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(a))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(a))) };
 	return {
 		s.x() * cosa, s.y() * -sina, t.x(),
 		s.x() * sina, s.y() * cosa , t.y(),
@@ -289,8 +307,10 @@ typename std::enable_if<_R == 3 && _C == 3, mv::Matrix<T, R, C, D>>::type mv::Ma
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
-	double cosa{ std::cos(a) };
-	double sina{ std::sin(a) };
+	using std::cos;
+	using std::sin;
+	T cosa{ static_cast<T>(cos(static_cast<T>(a))) };
+	T sina{ static_cast<T>(sin(static_cast<T>(a))) };
 	return {
 		s * cosa, s * -sina, t.x(),
 		s * sina, s * cosa , t.y(),
@@ -515,6 +535,53 @@ template <typename T, unsigned int R, unsigned int C, bool D>
 template <unsigned int _R, unsigned int _C>
 typename std::enable_if<_R == _C, typename mv::Matrix<T, R, C, D>::value_type>::type mv::Matrix<T, R, C, D>::determinant() const
 {
+	static_assert(_R == R && _C == C, "template arguments do not match default");
+
+	return this->_determinant(std::integral_constant<unsigned int, R>{});
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+typename mv::Matrix<T, R, C, D>::value_type mv::Matrix<T, R, C, D>::_determinant(std::integral_constant<unsigned int, 2>) const
+{
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+typename mv::Matrix<T, R, C, D>::value_type mv::Matrix<T, R, C, D>::_determinant(std::integral_constant<unsigned int, 3>) const
+{
+	// cofactor expansion along the first row
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+		- m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0))
+		+ m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+typename mv::Matrix<T, R, C, D>::value_type mv::Matrix<T, R, C, D>::_determinant(std::integral_constant<unsigned int, 4>) const
+{
+	// Laplace expansion over the 2x2 minors of the top two and the bottom two rows
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	T s0{ m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1) };
+	T s1{ m(0, 0) * m(1, 2) - m(1, 0) * m(0, 2) };
+	T s2{ m(0, 0) * m(1, 3) - m(1, 0) * m(0, 3) };
+	T s3{ m(0, 1) * m(1, 2) - m(1, 1) * m(0, 2) };
+	T s4{ m(0, 1) * m(1, 3) - m(1, 1) * m(0, 3) };
+	T s5{ m(0, 2) * m(1, 3) - m(1, 2) * m(0, 3) };
+	T c0{ m(2, 0) * m(3, 1) - m(3, 0) * m(2, 1) };
+	T c1{ m(2, 0) * m(3, 2) - m(3, 0) * m(2, 2) };
+	T c2{ m(2, 0) * m(3, 3) - m(3, 0) * m(2, 3) };
+	T c3{ m(2, 1) * m(3, 2) - m(3, 1) * m(2, 2) };
+	T c4{ m(2, 1) * m(3, 3) - m(3, 1) * m(2, 3) };
+	T c5{ m(2, 2) * m(3, 3) - m(3, 2) * m(2, 3) };
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+template <unsigned int N>
+typename mv::Matrix<T, R, C, D>::value_type mv::Matrix<T, R, C, D>::_determinant(std::integral_constant<unsigned int, N>) const
+{
+	// sum over all permutations, generated with Heap's algorithm
 	unsigned int permutation[this->outer_dimension];
 	for (unsigned int i{ 0 }; i < this->outer_dimension; ++i) {
 		permutation[i] = i;
@@ -576,14 +643,95 @@ typename std::enable_if<_R == _C, mv::Matrix<T, R, C, D>>::type mv::Matrix<T, R,
 {
 	static_assert(_R == R && _C == C, "template arguments do not match default");
 
+	return this->_inverse(std::integral_constant<unsigned int, R>{});
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+mv::Matrix<T, R, C, D> mv::Matrix<T, R, C, D>::_inverse(std::integral_constant<unsigned int, 2>) const
+{
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	T inv_det{ T{ 1 } / (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) };
+	mv::Matrix<T, R, C, D> inv{ nullptr };
+	inv(0, 0) = m(1, 1) * inv_det;
+	inv(0, 1) = -m(0, 1) * inv_det;
+	inv(1, 0) = -m(1, 0) * inv_det;
+	inv(1, 1) = m(0, 0) * inv_det;
+	return inv;
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+mv::Matrix<T, R, C, D> mv::Matrix<T, R, C, D>::_inverse(std::integral_constant<unsigned int, 3>) const
+{
+	// transposed cofactor matrix divided by the determinant
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	T c00{ m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1) };
+	T c10{ m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2) };
+	T c20{ m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0) };
+	T inv_det{ T{ 1 } / (m(0, 0) * c00 + m(0, 1) * c10 + m(0, 2) * c20) };
+	mv::Matrix<T, R, C, D> inv{ nullptr };
+	inv(0, 0) = c00 * inv_det;
+	inv(0, 1) = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * inv_det;
+	inv(0, 2) = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * inv_det;
+	inv(1, 0) = c10 * inv_det;
+	inv(1, 1) = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * inv_det;
+	inv(1, 2) = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * inv_det;
+	inv(2, 0) = c20 * inv_det;
+	inv(2, 1) = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * inv_det;
+	inv(2, 2) = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * inv_det;
+	return inv;
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+mv::Matrix<T, R, C, D> mv::Matrix<T, R, C, D>::_inverse(std::integral_constant<unsigned int, 4>) const
+{
+	// adjugate from the same 2x2 minors as the determinant
+	const mv::Matrix<T, R, C, D>& m{ *this };
+	T s0{ m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1) };
+	T s1{ m(0, 0) * m(1, 2) - m(1, 0) * m(0, 2) };
+	T s2{ m(0, 0) * m(1, 3) - m(1, 0) * m(0, 3) };
+	T s3{ m(0, 1) * m(1, 2) - m(1, 1) * m(0, 2) };
+	T s4{ m(0, 1) * m(1, 3) - m(1, 1) * m(0, 3) };
+	T s5{ m(0, 2) * m(1, 3) - m(1, 2) * m(0, 3) };
+	T c0{ m(2, 0) * m(3, 1) - m(3, 0) * m(2, 1) };
+	T c1{ m(2, 0) * m(3, 2) - m(3, 0) * m(2, 2) };
+	T c2{ m(2, 0) * m(3, 3) - m(3, 0) * m(2, 3) };
+	T c3{ m(2, 1) * m(3, 2) - m(3, 1) * m(2, 2) };
+	T c4{ m(2, 1) * m(3, 3) - m(3, 1) * m(2, 3) };
+	T c5{ m(2, 2) * m(3, 3) - m(3, 2) * m(2, 3) };
+	T inv_det{ T{ 1 } / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0) };
+	mv::Matrix<T, R, C, D> inv{ nullptr };
+	inv(0, 0) = (m(1, 1) * c5 - m(1, 2) * c4 + m(1, 3) * c3) * inv_det;
+	inv(0, 1) = (-m(0, 1) * c5 + m(0, 2) * c4 - m(0, 3) * c3) * inv_det;
+	inv(0, 2) = (m(3, 1) * s5 - m(3, 2) * s4 + m(3, 3) * s3) * inv_det;
+	inv(0, 3) = (-m(2, 1) * s5 + m(2, 2) * s4 - m(2, 3) * s3) * inv_det;
+	inv(1, 0) = (-m(1, 0) * c5 + m(1, 2) * c2 - m(1, 3) * c1) * inv_det;
+	inv(1, 1) = (m(0, 0) * c5 - m(0, 2) * c2 + m(0, 3) * c1) * inv_det;
+	inv(1, 2) = (-m(3, 0) * s5 + m(3, 2) * s2 - m(3, 3) * s1) * inv_det;
+	inv(1, 3) = (m(2, 0) * s5 - m(2, 2) * s2 + m(2, 3) * s1) * inv_det;
+	inv(2, 0) = (m(1, 0) * c4 - m(1, 1) * c2 + m(1, 3) * c0) * inv_det;
+	inv(2, 1) = (-m(0, 0) * c4 + m(0, 1) * c2 - m(0, 3) * c0) * inv_det;
+	inv(2, 2) = (m(3, 0) * s4 - m(3, 1) * s2 + m(3, 3) * s0) * inv_det;
+	inv(2, 3) = (-m(2, 0) * s4 + m(2, 1) * s2 - m(2, 3) * s0) * inv_det;
+	inv(3, 0) = (-m(1, 0) * c3 + m(1, 1) * c1 - m(1, 2) * c0) * inv_det;
+	inv(3, 1) = (m(0, 0) * c3 - m(0, 1) * c1 + m(0, 2) * c0) * inv_det;
+	inv(3, 2) = (-m(3, 0) * s3 + m(3, 1) * s1 - m(3, 2) * s0) * inv_det;
+	inv(3, 3) = (m(2, 0) * s3 - m(2, 1) * s1 + m(2, 2) * s0) * inv_det;
+	return inv;
+}
+
+template <typename T, unsigned int R, unsigned int C, bool D>
+template <unsigned int N>
+mv::Matrix<T, R, C, D> mv::Matrix<T, R, C, D>::_inverse(std::integral_constant<unsigned int, N>) const
+{
 	// Gauss-Jordan algorithm
 	mv::Matrix<T, R, C, D> mat{ *this };
 	mv::Matrix<T, R, C, D> inv{ this->identity() };
 	for (unsigned int p{ 0 }; p < this->outer_dimension; ++p) {
 		// get highest possible value to set pivot to, to avoid getting a value just slightly off zero
+		using std::abs;
 		unsigned int i_max{ p };
 		for (unsigned int i{ p + 1 }; i < this->outer_dimension; ++i) {
-			if (std::abs(mat[i][p]) > std::abs(mat[i_max][p])) {
+			if (abs(mat[i][p]) > abs(mat[i_max][p])) {
 				i_max = i;
 			}
 		}
@@ -615,6 +763,35 @@ typename std::enable_if<_R == _C, mv::Matrix<T, R, C, D>>::type mv::Matrix<T, R,
 	return inv;
 }
 
+template <typename T, unsigned int R, unsigned int C, bool D>
+template <unsigned int _R, unsigned int _C>
+typename std::enable_if<_R == _C && (_R > 1), mv::Matrix<T, R, C, D>>::type mv::Matrix<T, R, C, D>::affine_inverse() const
+{
+	static_assert(_R == R && _C == C, "template arguments do not match default");
+
+	// [A t; 0 1]^-1 = [A^-1 -A^-1 t; 0 1]
+	mv::Matrix<T, R - 1, C - 1, D> linear{ nullptr };
+	for (unsigned int row{ 0 }; row < R - 1; ++row) {
+		for (unsigned int column{ 0 }; column < C - 1; ++column) {
+			linear(row, column) = this->at(row, column);
+		}
+	}
+	linear = linear.inverse();
+
+	mv::Matrix<T, R, C, D> inv{ nullptr };
+	for (unsigned int row{ 0 }; row < R - 1; ++row) {
+		T translate{ 0 };
+		for (unsigned int column{ 0 }; column < C - 1; ++column) {
+			inv(row, column) = linear(row, column);
+			translate -= linear(row, column) * this->at(column, C - 1);
+		}
+		inv(row, C - 1) = translate;
+		inv(R - 1, row) = T{ 0 };
+	}
+	inv(R - 1, C - 1) = T{ 1 };
+	return inv;
+}
+
 
 
 template <typename T, unsigned int R, unsigned int C, bool D>
@@ -753,6 +930,16 @@ template <typename TR, unsigned int CR, bool DR>
 mv::Matrix<decltype(std::declval<T>() * std::declval<TR>()), R, CR, D> mv::Matrix<T, R, C, D>::operator*(const mv::Matrix<TR, C, CR, DR>& rhs) const
 {
 	mv::Matrix<decltype(std::declval<T>() * std::declval<TR>()), R, CR, D> retval{};
+	if constexpr (mv::simd::supported_matrix<T, R>::value && std::is_same<T, TR>::value && R == C && C == CR && D == DR) {
+		// stored column by column both factors are stored transposed, and (ab)^T = b^T a^T
+		if constexpr (D == ROW) {
+			mv::simd::multiply<R>(&this->at(0, 0), &rhs(0, 0), &retval(0, 0));
+		}
+		else {
+			mv::simd::multiply<R>(&rhs(0, 0), &this->at(0, 0), &retval(0, 0));
+		}
+		return retval;
+	}
 	for (unsigned int r{ 0 }; r < retval.row_count; ++r) {
 		for (unsigned int c{ 0 }; c < retval.column_count; ++c) {
 			for (unsigned int i{ 0 }; i < this->column_count; ++i) {
@@ -768,6 +955,15 @@ template <typename TR>
 mv::Vector<decltype(std::declval<T>() * std::declval<TR>()), R, mv::COLUMN> mv::Matrix<T, R, C, D>::operator*(const mv::Vector<TR, C, mv::COLUMN>& rhs) const
 {
 	mv::Vector<decltype(std::declval<T>() * std::declval<TR>()), R, COLUMN> retval{};
+	if constexpr (mv::simd::supported_matrix<T, R>::value && std::is_same<T, TR>::value && R == C) {
+		if constexpr (D == ROW) {
+			mv::simd::transform_rows<R>(&this->at(0, 0), &rhs[0], &retval[0]);
+		}
+		else {
+			mv::simd::transform_columns<R>(&this->at(0, 0), &rhs[0], &retval[0]);
+		}
+		return retval;
+	}
 	for (unsigned int r{ 0 }; r < retval.dimension; ++r) {
 		for (unsigned int i{ 0 }; i < this->column_count; ++i) {
 			retval[r] += this->at(r, i) * rhs[i];
@@ -58,7 +58,7 @@ void mv::Multiverse::init()
 	renderer_settings.window.title = "Window Title";
 	renderer_settings.window.width = 640;
 	renderer_settings.window.height = 480;
-	_thread_pool = new ThreadPool(std::min(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+	_thread_pool = new ThreadPool(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
 	_renderer = new Renderer(renderer_settings);
 	_resource_manager = new ResourceManager("../Data/");
 }
@@ -90,11 +90,12 @@ void mv::Multiverse::run()
 			behind_time -= tick_duration;
 		}
 
+		float pending_time = std::chrono::duration_cast<std::chrono::duration<float>>(behind_time).count();
 		for (Universe<2>& universe : _universes2d) {
-			universe.render(frame_interval);
+			universe.render(frame_interval, pending_time);
 		}
 		for (Universe<3>& universe : _universes3d) {
-			universe.render(frame_interval);
+			universe.render(frame_interval, pending_time);
 		}
 		_renderer->render();
 	}
@@ -0,0 +1,280 @@
+/**
+	\file Simd.h
+	\brief SSE kernels for small float vectors and matrices
+
+	Vector and Matrix forward their float operations on 2, 3 and 4 element vectors and 3x3 and 4x4 matrices
+	to these kernels when MV_SIMD is enabled, all other types keep their element-wise loops.
+	Kernels work on plain arrays with unaligned loads, so the storage layout of Vector and Matrix is unchanged,
+	and 2 and 3 element arrays are never read or written past their end.
+	Sums are taken in the same order as the element-wise loops, so both give identical results.
+
+	The lane types at the end serve the structure of arrays kernels of BatchMath and CollisionBatch instead,
+	which process one value per lane for a whole batch.
+*/
+
+#pragma once
+#include "setup.h"
+
+#include <cmath> // abs, nearbyint, sqrt
+#include <type_traits> // false_type, true_type
+
+#if MV_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace mv
+{
+	namespace simd
+	{
+		/**
+			\brief whether vectors of N elements of type T are handled by the kernels
+		*/
+		template <typename T, unsigned int N>
+		struct supported : std::false_type {};
+
+		/**
+			\brief whether square matrices of N by N elements of type T are handled by the kernels
+		*/
+		template <typename T, unsigned int N>
+		struct supported_matrix : std::false_type {};
+
+#if MV_SIMD
+		template <>
+		struct supported<float, 2> : std::true_type {};
+		template <>
+		struct supported<float, 3> : std::true_type {};
+		template <>
+		struct supported<float, 4> : std::true_type {};
+		template <>
+		struct supported_matrix<float, 3> : std::true_type {};
+		template <>
+		struct supported_matrix<float, 4> : std::true_type {};
+
+
+		template <unsigned int N>
+		__m128 load(const float* p);
+		template <>
+		inline __m128 load<2>(const float* p)
+		{
+			return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+		}
+		template <>
+		inline __m128 load<3>(const float* p)
+		{
+			return _mm_movelh_ps(load<2>(p), _mm_load_ss(p + 2));
+		}
+		template <>
+		inline __m128 load<4>(const float* p)
+		{
+			return _mm_loadu_ps(p);
+		}
+
+		template <unsigned int N>
+		void store(float* p, __m128 v);
+		template <>
+		inline void store<2>(float* p, __m128 v)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+		}
+		template <>
+		inline void store<3>(float* p, __m128 v)
+		{
+			store<2>(p, v);
+			_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+		}
+		template <>
+		inline void store<4>(float* p, __m128 v)
+		{
+			_mm_storeu_ps(p, v);
+		}
+
+		// sum of all four lanes, first to last like the element-wise loops
+		inline float horizontal_sum(__m128 v)
+		{
+			__m128 sum{ _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))) };
+			sum = _mm_add_ss(sum, _mm_movehl_ps(v, v));
+			return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+		}
+
+
+		template <unsigned int N>
+		inline float dot(const float* a, const float* b)
+		{
+			return horizontal_sum(_mm_mul_ps(load<N>(a), load<N>(b)));
+		}
+
+		template <unsigned int N>
+		inline void add(float* a, const float* b)
+		{
+			store<N>(a, _mm_add_ps(load<N>(a), load<N>(b)));
+		}
+
+		template <unsigned int N>
+		inline void subtract(float* a, const float* b)
+		{
+			store<N>(a, _mm_sub_ps(load<N>(a), load<N>(b)));
+		}
+
+		template <unsigned int N>
+		inline void scale(float* a, float s)
+		{
+			store<N>(a, _mm_mul_ps(load<N>(a), _mm_set1_ps(s)));
+		}
+
+		/**
+			\brief out = a * b for N by N matrices stored row by row
+
+			For matrices stored column by column pass b as a and a as b, as the transposed product swaps the factors.
+			out may not alias a or b.
+		*/
+		template <unsigned int N>
+		inline void multiply(const float* a, const float* b, float* out)
+		{
+			__m128 rows[N];
+			for (unsigned int i{ 0 }; i < N; ++i) {
+				rows[i] = load<N>(b + i * N);
+			}
+			for (unsigned int r{ 0 }; r < N; ++r) {
+				__m128 sum{ _mm_mul_ps(_mm_set1_ps(a[r * N]), rows[0]) };
+				for (unsigned int i{ 1 }; i < N; ++i) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[r * N + i]), rows[i]));
+				}
+				store<N>(out + r * N, sum);
+			}
+		}
+
+		/**
+			\brief out = m * v for an N by N matrix stored row by row and a column vector
+		*/
+		template <unsigned int N>
+		inline void transform_rows(const float* m, const float* v, float* out)
+		{
+			__m128 x{ load<N>(v) };
+			__m128 products[4]{ _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (unsigned int r{ 0 }; r < N; ++r) {
+				products[r] = _mm_mul_ps(load<N>(m + r * N), x);
+			}
+			// transposing the products makes every lane of the sum one row's dot product
+			_MM_TRANSPOSE4_PS(products[0], products[1], products[2], products[3]);
+			store<N>(out, _mm_add_ps(_mm_add_ps(_mm_add_ps(products[0], products[1]), products[2]), products[3]));
+		}
+
+		/**
+			\brief out = m * v for an N by N matrix stored column by column and a column vector
+		*/
+		template <unsigned int N>
+		inline void transform_columns(const float* m, const float* v, float* out)
+		{
+			__m128 sum{ _mm_mul_ps(load<N>(m), _mm_set1_ps(v[0])) };
+			for (unsigned int c{ 1 }; c < N; ++c) {
+				sum = _mm_add_ps(sum, _mm_mul_ps(load<N>(m + c * N), _mm_set1_ps(v[c])));
+			}
+			store<N>(out, sum);
+		}
+#else
+		// declared so that calls in discarded branches still name a function, never defined or called without MV_SIMD
+
+		template <unsigned int N>
+		float dot(const float* a, const float* b);
+		template <unsigned int N>
+		void add(float* a, const float* b);
+		template <unsigned int N>
+		void subtract(float* a, const float* b);
+		template <unsigned int N>
+		void scale(float* a, float s);
+		template <unsigned int N>
+		void multiply(const float* a, const float* b, float* out);
+		template <unsigned int N>
+		void transform_rows(const float* m, const float* v, float* out);
+		template <unsigned int N>
+		void transform_columns(const float* m, const float* v, float* out);
+#endif
+
+		/**
+			\brief one float per lane, the reference the SSE lanes are checked against
+
+			Batch kernels are templates over a lane type and written once, so the scalar and the SSE instantiation
+			perform the same operations in the same order and give identical results.
+		*/
+		struct ScalarLanes
+		{
+			using value_type = float;
+			using mask_type = bool;
+			static constexpr size_type width = 1;
+
+			static value_type load(const float* p) { return *p; }
+			static void store(float* p, value_type v) { *p = v; }
+			static value_type set(float f) { return f; }
+
+			static value_type add(value_type a, value_type b) { return a + b; }
+			static value_type sub(value_type a, value_type b) { return a - b; }
+			static value_type mul(value_type a, value_type b) { return a * b; }
+			static value_type div(value_type a, value_type b) { return a / b; }
+			static value_type sqrt(value_type v) { return std::sqrt(v); }
+			static value_type negate(value_type v) { return -v; }
+			static value_type abs(value_type v) { return std::abs(v); }
+			static value_type min(value_type a, value_type b) { return a < b ? a : b; }
+			static value_type max(value_type a, value_type b) { return a > b ? a : b; }
+			static value_type round(value_type v) { return std::nearbyint(v); }
+
+			static mask_type less(value_type a, value_type b) { return a < b; }
+			static mask_type less_equal(value_type a, value_type b) { return a <= b; }
+			static mask_type greater_equal(value_type a, value_type b) { return a >= b; }
+			static mask_type both(mask_type a, mask_type b) { return a && b; }
+			static mask_type bit(value_type integral, int b) { return (static_cast<int>(integral) & b) != 0; }
+			static value_type select(mask_type mask, value_type a, value_type b) { return mask ? a : b; }
+		};
+
+#if MV_SIMD
+		/**
+			\brief four floats per lane in an SSE register, masks are all ones or all zeros per float
+		*/
+		struct SseLanes
+		{
+			using value_type = __m128;
+			using mask_type = __m128;
+			static constexpr size_type width = 4;
+
+			static value_type load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, value_type v) { _mm_storeu_ps(p, v); }
+			static value_type set(float f) { return _mm_set1_ps(f); }
+
+			static value_type add(value_type a, value_type b) { return _mm_add_ps(a, b); }
+			static value_type sub(value_type a, value_type b) { return _mm_sub_ps(a, b); }
+			static value_type mul(value_type a, value_type b) { return _mm_mul_ps(a, b); }
+			static value_type div(value_type a, value_type b) { return _mm_div_ps(a, b); }
+			static value_type sqrt(value_type v) { return _mm_sqrt_ps(v); }
+			static value_type negate(value_type v) { return _mm_xor_ps(v, _mm_set1_ps(-0.f)); }
+			static value_type abs(value_type v) { return _mm_andnot_ps(_mm_set1_ps(-0.f), v); }
+			static value_type min(value_type a, value_type b) { return _mm_min_ps(a, b); } // a < b ? a : b
+			static value_type max(value_type a, value_type b) { return _mm_max_ps(a, b); } // a > b ? a : b
+			static value_type round(value_type v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); } // nearest, ties to even
+
+			static mask_type less(value_type a, value_type b) { return _mm_cmplt_ps(a, b); }
+			static mask_type less_equal(value_type a, value_type b) { return _mm_cmple_ps(a, b); }
+			static mask_type greater_equal(value_type a, value_type b) { return _mm_cmpge_ps(a, b); }
+			static mask_type both(mask_type a, mask_type b) { return _mm_and_ps(a, b); }
+			static mask_type bit(value_type integral, int b)
+			{
+				__m128i bits{ _mm_and_si128(_mm_cvttps_epi32(integral), _mm_set1_epi32(b)) };
+				return _mm_castsi128_ps(_mm_cmpeq_epi32(bits, _mm_set1_epi32(b)));
+			}
+			static value_type select(mask_type mask, value_type a, value_type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		};
+
+		using KernelLanes = SseLanes; // widest lanes available, batch kernels finish the last partial group with ScalarLanes
+#else
+		using KernelLanes = ScalarLanes;
+#endif
+
+		/**
+			\brief row of a 2D affine transformation applied to lanes of points, same operation order as Matrix * Vector
+		*/
+		template <typename Lanes>
+		typename Lanes::value_type transform_row(typename Lanes::value_type m0, typename Lanes::value_type m1, typename Lanes::value_type m2,
+			typename Lanes::value_type x, typename Lanes::value_type y)
+		{
+			return Lanes::add(Lanes::add(Lanes::add(Lanes::set(0.f), Lanes::mul(m0, x)), Lanes::mul(m1, y)), Lanes::mul(m2, Lanes::set(1.f)));
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#include "MultiversePCH.h"
+#include "SpatialQueryBatch.h"
+
+template <mv::uint dims>
+mv::size_type mv::SpatialQueryBatch<dims>::add_radius(const position_type& origin, float radius, CollisionLayerMask layers)
+{
+	Query query{ origin, origin, origin, radius, layers };
+	for (uint i = 0; i < dims; ++i) {
+		query.lower[i] -= radius;
+		query.upper[i] += radius;
+	}
+	this->_queries.push_back(query);
+	return static_cast<size_type>(this->_queries.size() - 1);
+}
+
+template <mv::uint dims>
+mv::size_type mv::SpatialQueryBatch<dims>::add_box(const position_type& lower, const position_type& upper, CollisionLayerMask layers)
+{
+	this->_queries.push_back(Query{ (lower + upper) * 0.5f, lower, upper, -1.f, layers });
+	return static_cast<size_type>(this->_queries.size() - 1);
+}
+
+template <mv::uint dims>
+void mv::SpatialQueryBatch<dims>::clear()
+{
+	this->_queries.clear();
+	this->_offsets.clear();
+	this->_results.clear();
+}
+
+
+template <mv::uint dims>
+mv::size_type mv::SpatialQueryBatch<dims>::size() const
+{
+	return static_cast<size_type>(this->_queries.size());
+}
+
+template <mv::uint dims>
+bool mv::SpatialQueryBatch<dims>::empty() const
+{
+	return this->_queries.empty();
+}
+
+
+template <mv::uint dims>
+mv::size_type mv::SpatialQueryBatch<dims>::offset(size_type query) const
+{
+	return this->_offsets.at(query);
+}
+
+template <mv::uint dims>
+mv::size_type mv::SpatialQueryBatch<dims>::result_count(size_type query) const
+{
+	return this->_offsets.at(query + 1) - this->_offsets.at(query);
+}
+
+template <mv::uint dims>
+mv::Entity<dims>* const* mv::SpatialQueryBatch<dims>::begin(size_type query) const
+{
+	return this->_results.data() + this->_offsets.at(query);
+}
+
+template <mv::uint dims>
+mv::Entity<dims>* const* mv::SpatialQueryBatch<dims>::end(size_type query) const
+{
+	return this->_results.data() + this->_offsets.at(query + 1);
+}
+
+
+template <mv::uint dims>
+const std::vector<mv::size_type>& mv::SpatialQueryBatch<dims>::offsets() const
+{
+	return this->_offsets;
+}
+
+template <mv::uint dims>
+const std::vector<mv::Entity<dims>*>& mv::SpatialQueryBatch<dims>::results() const
+{
+	return this->_results;
+}
+
+
+
+
+template class mv::SpatialQueryBatch<2>;
+template class mv::SpatialQueryBatch<3>;
@@ -0,0 +1,101 @@
+#pragma once
+#include "setup.h"
+
+#include <vector>
+
+#include "Transform.h"
+#include "Collider.h"
+
+namespace mv
+{
+	template <uint dims>
+	class Entity;
+	template <uint dims>
+	class Universe;
+
+	/**
+		\brief list of radius and box queries resolved together by Universe::resolve_queries
+
+		Results are stored compressed: the results of query i are the entities from offset(i) up to offset(i + 1).
+		Results of a query are grouped by cell, in no particular order otherwise.
+		All buffers are kept between resolves, so reusing a batch every tick does not allocate once it has grown.
+	*/
+	template <uint dims>
+	class SpatialQueryBatch
+	{
+		friend Universe<dims>;
+
+	public:
+		using transform_type = Transform<dims>;
+		using position_type = decltype(transform_type::translate);
+
+	private:
+		struct Query
+		{
+			position_type origin;
+			position_type lower;
+			position_type upper;
+			float radius; // negative for box queries
+			CollisionLayerMask layers;
+		};
+
+		struct CellQuery
+		{
+			uint cell;
+			size_type query;
+		};
+
+		struct Chunk
+		{
+			std::vector<Entity<dims>*> entities; // entities of the cell being resolved
+			std::vector<position_type> positions; // snapshot position of each of entities
+			std::vector<CollisionLayerMask> layers; // collision layers of each of entities
+			std::vector<Entity<dims>*> results;
+			std::vector<size_type> counts; // result count per pair in the chunk
+		};
+
+		std::vector<Query> _queries;
+		std::vector<uint> _cells; // cells of the query being paired
+		std::vector<CellQuery> _pairs; // every query with each cell it overlaps, sorted by cell
+		std::vector<size_type> _cursors; // next result offset of each query while results are placed
+		std::vector<Chunk> _chunks;
+		std::vector<size_type> _offsets;
+		std::vector<Entity<dims>*> _results;
+
+	public:
+		SpatialQueryBatch() = default;
+
+		/**
+			\brief add query for all entities positioned within radius of origin
+			\returns index of the query
+		*/
+		size_type add_radius(const position_type& origin, float radius, CollisionLayerMask layers = all_collision_layers);
+		/**
+			\brief add query for all entities positioned inside the axis aligned box from lower to upper
+			\returns index of the query
+		*/
+		size_type add_box(const position_type& lower, const position_type& upper, CollisionLayerMask layers = all_collision_layers);
+		/**
+			\brief remove all queries and results
+		*/
+		void clear();
+
+		size_type size() const;
+		bool empty() const;
+
+		/**
+			\brief get offset of the first result of a query in results(), offset(size()) is the total result count
+		*/
+		size_type offset(size_type query) const;
+		size_type result_count(size_type query) const;
+		Entity<dims>* const* begin(size_type query) const;
+		Entity<dims>* const* end(size_type query) const;
+
+		const std::vector<size_type>& offsets() const;
+		const std::vector<Entity<dims>*>& results() const;
+	};
+
+
+	using SpatialQueryBatch2D = SpatialQueryBatch<2>;
+	using SpatialQueryBatch3D = SpatialQueryBatch<3>;
+}
@@ -1,8 +1,13 @@
 #pragma once
 #include "setup.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <queue>
@@ -34,6 +39,17 @@ namespace mv
 
 		template <typename F, typename... Args, typename R = typename std::invoke_result<F, Args...>::type>
 		std::future<R> enqueue(F&& task, Args&&... args);
+		/**
+			\brief invoke task(i) for every i in [0, count) spread over the pool
+			\param count amount of work items
+			\param task callable invoked as task(size_type)
+
+			The calling thread works on items as well and returns once all items are finished,
+			so this may also be called from inside a pool task without deadlocking.
+			Items are handed out in ascending order, but may finish in any order.
+		*/
+		template <typename F>
+		void parallel_for(size_type count, F&& task);
 
 	private:
 		void _task_loop();
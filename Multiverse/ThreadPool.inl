@@ -17,3 +17,54 @@ inline std::future<R> mv::ThreadPool::enqueue(F&& task, Args&&... args)
 	this->_condition.notify_one();
 	return fut;
 }
+
+template <typename F>
+inline void mv::ThreadPool::parallel_for(size_type count, F&& task)
+{
+	if (count == 0)
+		return;
+	if (count == 1 || this->_threads.empty()) {
+		for (size_type i = 0; i < count; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	struct State
+	{
+		std::function<void(size_type)> task;
+		size_type count;
+		std::atomic<size_type> next;
+		std::atomic<size_type> done;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	// shared, helpers that only get scheduled after all items are finished must still find valid state
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->task = std::forward<F>(task);
+	state->count = count;
+	state->next = 0;
+	state->done = 0;
+
+	auto work = [state]() {
+		for (size_type i = state->next++; i < state->count; i = state->next++) {
+			state->task(i);
+			if (++state->done == state->count) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	size_type helper_count = std::min(count - 1, static_cast<size_type>(this->_threads.size()));
+	this->_task_mutex.lock();
+	for (size_type i = 0; i < helper_count; ++i) {
+		this->_task_queue.push(work);
+	}
+	this->_task_mutex.unlock();
+	this->_condition.notify_all();
+
+	work();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state]() { return state->done == state->count; });
+}
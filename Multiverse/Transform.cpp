@@ -1,6 +1,11 @@
 #include "MultiversePCH.h"
 #include "Transform.h"
 
+#include <cmath>	// cos, sin
+
+#include "BatchMath.h"
+#include "Fixed.h"
+
 mv::Transform<2>::Transform()
 	: translate{ 0.f, 0.f }, rotate{ 0.f }, scale{ 1.f, 1.f }
 {}
@@ -18,9 +23,52 @@ bool mv::Transform<2>::operator!=(const Transform<2>& rhs) const
 
 mv::mat3f mv::Transform<2>::transform_matrix() const
 {
-	return mat3f::transform(translate, rotate, scale);
+	Trig trig;
+	this->update_trig(trig);
+	return this->transform_matrix(trig);
+}
+
+mv::mat3f mv::Transform<2>::inverse_transform_matrix() const
+{
+	Trig trig;
+	this->update_trig(trig);
+	return this->inverse_transform_matrix(trig);
+}
+
+void mv::Transform<2>::update_trig(Trig& trig) const
+{
+	if (this->rotate == trig.rotate) {
+		return;
+	}
+#if MV_FAST_TRIG && !MV_FIXED_POINT_TRIG
+	batch::sincos(this->rotate, trig.sin, trig.cos);
+#else
+	trig.cos = angle_cos(this->rotate);
+	trig.sin = angle_sin(this->rotate);
+#endif
+	trig.rotate = this->rotate;
+}
+
+mv::mat3f mv::Transform<2>::transform_matrix(const Trig& trig) const
+{
+	return {
+		this->scale.x() * trig.cos, -this->scale.y() * trig.sin, this->translate.x(),
+		this->scale.x() * trig.sin, this->scale.y() * trig.cos , this->translate.y(),
+		0.f                       , 0.f                        , 1.f
+	};
 }
 
+mv::mat3f mv::Transform<2>::inverse_transform_matrix(const Trig& trig) const
+{
+	// (T R S)^-1 = S^-1 R^T T^-1
+	vec2f row0{ trig.cos / scale.x(), trig.sin / scale.x() };
+	vec2f row1{ -trig.sin / scale.y(), trig.cos / scale.y() };
+	return {
+		row0.x(), row0.y(), -(row0.x() * translate.x() + row0.y() * translate.y()),
+		row1.x(), row1.y(), -(row1.x() * translate.x() + row1.y() * translate.y()),
+		0.f     , 0.f     , 1.f
+	};
+}
 
 
 
@@ -41,7 +89,57 @@ bool mv::Transform<3>::operator!=(const Transform<3>& rhs) const
 
 mv::mat4f mv::Transform<3>::transform_matrix() const
 {
-	return mat4f::identity();//mat4f::transform(translate, rotate, scale);
+	// rotation matrix of the unit quaternion, columns scaled by the scale vector
+	float xx{ rotate.x * rotate.x }, yy{ rotate.y * rotate.y }, zz{ rotate.z * rotate.z };
+	float xy{ rotate.x * rotate.y }, xz{ rotate.x * rotate.z }, yz{ rotate.y * rotate.z };
+	float wx{ rotate.w * rotate.x }, wy{ rotate.w * rotate.y }, wz{ rotate.w * rotate.z };
+	return {
+		scale.x() * (1.f - 2.f * (yy + zz)), scale.y() * 2.f * (xy - wz)        , scale.z() * 2.f * (xz + wy)        , translate.x(),
+		scale.x() * 2.f * (xy + wz)        , scale.y() * (1.f - 2.f * (xx + zz)), scale.z() * 2.f * (yz - wx)        , translate.y(),
+		scale.x() * 2.f * (xz - wy)        , scale.y() * 2.f * (yz + wx)        , scale.z() * (1.f - 2.f * (xx + yy)), translate.z(),
+		0.f                                , 0.f                                , 0.f                                , 1.f
+	};
+}
+
+mv::mat4f mv::Transform<3>::inverse_transform_matrix() const
+{
+	// (T R S)^-1 = S^-1 R^T T^-1, the rows of R^T are the columns of the rotation matrix
+	float xx{ rotate.x * rotate.x }, yy{ rotate.y * rotate.y }, zz{ rotate.z * rotate.z };
+	float xy{ rotate.x * rotate.y }, xz{ rotate.x * rotate.z }, yz{ rotate.y * rotate.z };
+	float wx{ rotate.w * rotate.x }, wy{ rotate.w * rotate.y }, wz{ rotate.w * rotate.z };
+	vec3f row0{ 1.f - 2.f * (yy + zz), 2.f * (xy + wz), 2.f * (xz - wy) };
+	vec3f row1{ 2.f * (xy - wz), 1.f - 2.f * (xx + zz), 2.f * (yz + wx) };
+	vec3f row2{ 2.f * (xz + wy), 2.f * (yz - wx), 1.f - 2.f * (xx + yy) };
+	if (scale.x() == scale.y() && scale.x() == scale.z()) {
+		float inverse_scale{ 1.f / scale.x() };
+		row0 *= inverse_scale;
+		row1 *= inverse_scale;
+		row2 *= inverse_scale;
+	}
+	else {
+		row0 /= scale.x();
+		row1 /= scale.y();
+		row2 /= scale.z();
+	}
+	return {
+		row0.x(), row0.y(), row0.z(), -row0.dot(translate),
+		row1.x(), row1.y(), row1.z(), -row1.dot(translate),
+		row2.x(), row2.y(), row2.z(), -row2.dot(translate),
+		0.f     , 0.f     , 0.f     , 1.f
+	};
+}
+
+void mv::Transform<3>::update_trig(Trig&) const
+{}
+
+mv::mat4f mv::Transform<3>::transform_matrix(const Trig&) const
+{
+	return this->transform_matrix();
+}
+
+mv::mat4f mv::Transform<3>::inverse_transform_matrix(const Trig&) const
+{
+	return this->inverse_transform_matrix();
 }
 
 
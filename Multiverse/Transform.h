@@ -15,6 +15,16 @@ namespace mv
 	class Transform<2>
 	{
 	public:
+		/**
+			\brief cosine and sine of a rotation, kept by the owner of a transform that is placed often but rotated rarely
+		*/
+		struct Trig
+		{
+			float rotate{ 0.f }; // rotation cos and sin belong to
+			float cos{ 1.f };
+			float sin{ 0.f };
+		};
+
 		Transform();
 
 		vec2f translate;
@@ -24,13 +34,31 @@ namespace mv
 		bool operator==(const Transform<2>& rhs) const;
 		bool operator!=(const Transform<2>& rhs) const;
 
+		/**
+			\brief get the transformation matrix, applying scale, rotation and translation in that order
+		*/
 		mat3f transform_matrix() const;
+		/**
+			\brief get the inverse of transform_matrix(), built from the transposed rotation without a general inverse
+		*/
+		mat3f inverse_transform_matrix() const;
+		/**
+			\brief calculate the cosine and sine of rotate into trig, unless trig already holds them
+		*/
+		void update_trig(Trig& trig) const;
+		/**
+			\param trig cosine and sine of rotate, see update_trig
+		*/
+		mat3f transform_matrix(const Trig& trig) const;
+		mat3f inverse_transform_matrix(const Trig& trig) const;
 	};
 
 	template <>
 	class Transform<3>
 	{
 	public:
+		struct Trig {}; // quaternion rotations need no cosine and sine, see Transform<2>::Trig
+
 		Transform();
 
 		vec3f translate;
@@ -40,7 +68,19 @@ namespace mv
 		bool operator==(const Transform<3>& rhs) const;
 		bool operator!=(const Transform<3>& rhs) const;
 
+		/**
+			\brief get the transformation matrix, applying scale, rotation and translation in that order
+
+			rotate is expected to be a unit quaternion.
+		*/
 		mat4f transform_matrix() const;
+		/**
+			\brief get the inverse of transform_matrix(), built from the transposed rotation without a general inverse
+		*/
+		mat4f inverse_transform_matrix() const;
+		void update_trig(Trig& trig) const;
+		mat4f transform_matrix(const Trig& trig) const;
+		mat4f inverse_transform_matrix(const Trig& trig) const;
 	};
 
 	using Transform2D = Transform<2>;
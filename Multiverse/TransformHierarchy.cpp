@@ -0,0 +1,363 @@
+#include "MultiversePCH.h"
+#include "TransformHierarchy.h"
+
+#include <algorithm> // find
+#include <stdexcept> // runtime_error
+#include <utility> // move, swap
+
+
+namespace
+{
+	/**
+		\brief world transform of a child from the world transform of its parent and the local transform of the child
+	*/
+	mv::Transform<2> compose(const mv::Transform<2>& parent, const mv::mat3f& parent_matrix, const mv::Transform<2>& local)
+	{
+		mv::Transform<2> world;
+		world.translate = mv::vec2f{ parent_matrix * mv::vec3f{ local.translate, 1.f } };
+		world.rotate = parent.rotate + local.rotate;
+		for (mv::uint i = 0; i < 2; ++i) {
+			world.scale[i] = parent.scale[i] * local.scale[i];
+		}
+		return world;
+	}
+
+	mv::Transform<3> compose(const mv::Transform<3>& parent, const mv::mat4f& parent_matrix, const mv::Transform<3>& local)
+	{
+		mv::Transform<3> world;
+		world.translate = mv::vec3f{ parent_matrix * mv::vec4f{ local.translate, 1.f } };
+		world.rotate = parent.rotate * local.rotate;
+		for (mv::uint i = 0; i < 3; ++i) {
+			world.scale[i] = parent.scale[i] * local.scale[i];
+		}
+		return world;
+	}
+
+	/**
+		\brief local transform of a child from the world transforms of its parent and the child, undoes compose
+	*/
+	mv::Transform<2> decompose(const mv::Transform<2>& parent, const mv::Transform<2>& world)
+	{
+		mv::Transform<2> local;
+		local.translate = mv::vec2f{ parent.inverse_transform_matrix() * mv::vec3f{ world.translate, 1.f } };
+		local.rotate = world.rotate - parent.rotate;
+		for (mv::uint i = 0; i < 2; ++i) {
+			local.scale[i] = world.scale[i] / parent.scale[i];
+		}
+		return local;
+	}
+
+	mv::Transform<3> decompose(const mv::Transform<3>& parent, const mv::Transform<3>& world)
+	{
+		mv::Transform<3> local;
+		local.translate = mv::vec3f{ parent.inverse_transform_matrix() * mv::vec4f{ world.translate, 1.f } };
+		local.rotate = glm::inverse(parent.rotate) * world.rotate;
+		for (mv::uint i = 0; i < 3; ++i) {
+			local.scale[i] = world.scale[i] / parent.scale[i];
+		}
+		return local;
+	}
+
+	template <typename T>
+	void permute(std::vector<T>& values, const std::vector<mv::uint>& order)
+	{
+		std::vector<T> permuted;
+		permuted.reserve(values.size());
+		for (mv::uint i : order) {
+			permuted.push_back(std::move(values[i]));
+		}
+		std::swap(values, permuted);
+	}
+}
+
+
+
+template <mv::uint dims>
+mv::TransformHierarchy<dims>::TransformHierarchy()
+	: _index{}, _handles{}, _parent_handles{}, _children{}, _parents{}, _locals{}, _worlds{}, _matrices{},
+	_dirty{}, _changed{}, _trees{}, _built{ true }
+{}
+
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::add(handle_type node, const transform_type& local)
+{
+	if (this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::add: node is already in the hierarchy");
+	}
+	if (node >= this->_index.size()) {
+		this->_index.resize(node + 1, no_node);
+	}
+	this->_index[node] = static_cast<uint>(this->_handles.size());
+	this->_handles.push_back(node);
+	this->_parent_handles.push_back(invalid_id);
+	this->_children.emplace_back();
+	this->_parents.push_back(no_node);
+	this->_locals.push_back(local);
+	this->_worlds.push_back(local);
+	this->_matrices.push_back(local.transform_matrix());
+	this->_dirty.push_back(1);
+	this->_changed.push_back(0);
+	this->_built = false;
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::remove(handle_type node)
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::remove: node is not in the hierarchy");
+	}
+	uint i = this->_index[node];
+	for (handle_type child : this->_children[i]) {
+		uint j = this->_index[child];
+		this->_parent_handles[j] = invalid_id;
+		this->_locals[j] = this->_worlds[j];
+	}
+	this->_unlink(i);
+
+	// the last node takes the place of the removed one, the order is restored by the next build
+	uint last = static_cast<uint>(this->_handles.size() - 1);
+	this->_index[this->_handles[last]] = i;
+	this->_handles[i] = this->_handles[last];
+	this->_parent_handles[i] = this->_parent_handles[last];
+	std::swap(this->_children[i], this->_children[last]);
+	this->_locals[i] = this->_locals[last];
+	this->_worlds[i] = this->_worlds[last];
+	this->_matrices[i] = this->_matrices[last];
+	this->_dirty[i] = this->_dirty[last];
+	this->_handles.pop_back();
+	this->_parent_handles.pop_back();
+	this->_children.pop_back();
+	this->_parents.pop_back();
+	this->_locals.pop_back();
+	this->_worlds.pop_back();
+	this->_matrices.pop_back();
+	this->_dirty.pop_back();
+	this->_changed.pop_back();
+	this->_index[node] = no_node;
+	this->_built = false;
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::prune(handle_type node)
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::prune: node is not in the hierarchy");
+	}
+	uint i = this->_index[node];
+	if (this->_parent_handles[i] == invalid_id && this->_children[i].empty()) {
+		this->remove(node);
+	}
+}
+
+template <mv::uint dims>
+bool mv::TransformHierarchy<dims>::contains(handle_type node) const
+{
+	return node < this->_index.size() && this->_index[node] != no_node;
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::children(handle_type node, std::vector<handle_type>& out) const
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::children: node is not in the hierarchy");
+	}
+	const std::vector<handle_type>& children = this->_children[this->_index[node]];
+	out.insert(out.end(), children.begin(), children.end());
+}
+
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::set_parent(handle_type node, handle_type parent)
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::set_parent: node is not in the hierarchy");
+	}
+	if (parent != invalid_id && !this->contains(parent)) {
+		throw std::runtime_error("TransformHierarchy::set_parent: parent is not in the hierarchy");
+	}
+	uint i = this->_index[node];
+	// nodes only ever get parents from the hierarchy, so every ancestor is in it
+	for (handle_type ancestor = parent; ancestor != invalid_id; ancestor = this->_parent_handles[this->_index[ancestor]]) {
+		if (ancestor == node) {
+			throw std::runtime_error("TransformHierarchy::set_parent: a node cannot be its own ancestor");
+		}
+	}
+	if (this->_parent_handles[i] == parent) {
+		return;
+	}
+	this->_unlink(i);
+	if (parent != invalid_id) {
+		this->_children[this->_index[parent]].push_back(node);
+	}
+	this->_parent_handles[i] = parent;
+	this->_dirty[i] = 1;
+	this->_built = false;
+}
+
+template <mv::uint dims>
+typename mv::TransformHierarchy<dims>::handle_type mv::TransformHierarchy<dims>::parent(handle_type node) const
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::parent: node is not in the hierarchy");
+	}
+	return this->_parent_handles[this->_index[node]];
+}
+
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::set_local(handle_type node, const transform_type& local)
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::set_local: node is not in the hierarchy");
+	}
+	uint i = this->_index[node];
+	this->_locals[i] = local;
+	this->_dirty[i] = 1;
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::set_world(handle_type node, const transform_type& world)
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::set_world: node is not in the hierarchy");
+	}
+	this->_set_world(this->_index[node], world);
+}
+
+template <mv::uint dims>
+const typename mv::TransformHierarchy<dims>::transform_type& mv::TransformHierarchy<dims>::local(handle_type node) const
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::local: node is not in the hierarchy");
+	}
+	return this->_locals[this->_index[node]];
+}
+
+template <mv::uint dims>
+const typename mv::TransformHierarchy<dims>::transform_type& mv::TransformHierarchy<dims>::world(handle_type node) const
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::world: node is not in the hierarchy");
+	}
+	return this->_worlds[this->_index[node]];
+}
+
+template <mv::uint dims>
+const typename mv::TransformHierarchy<dims>::matrix_type& mv::TransformHierarchy<dims>::world_matrix(handle_type node) const
+{
+	if (!this->contains(node)) {
+		throw std::runtime_error("TransformHierarchy::world_matrix: node is not in the hierarchy");
+	}
+	return this->_matrices[this->_index[node]];
+}
+
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::build()
+{
+	if (this->_built) {
+		return;
+	}
+	uint count = static_cast<uint>(this->_handles.size());
+
+	// every tree breadth first from its root, the order itself serves as the queue
+	std::vector<uint> order;
+	order.reserve(count);
+	this->_trees.clear();
+	for (uint i = 0; i < count; ++i) {
+		if (this->_parent_handles[i] != invalid_id) {
+			continue;
+		}
+		uint begin = static_cast<uint>(order.size());
+		order.push_back(i);
+		for (uint j = begin; j < order.size(); ++j) {
+			for (handle_type child : this->_children[order[j]]) {
+				order.push_back(this->_index[child]);
+			}
+		}
+		this->_trees.push_back(Tree{ begin, static_cast<uint>(order.size()), true });
+	}
+
+	permute(this->_handles, order);
+	permute(this->_parent_handles, order);
+	permute(this->_children, order);
+	permute(this->_locals, order);
+	permute(this->_worlds, order);
+	permute(this->_matrices, order);
+	permute(this->_dirty, order);
+	for (uint i = 0; i < count; ++i) {
+		this->_index[this->_handles[i]] = i;
+	}
+	for (uint i = 0; i < count; ++i) {
+		this->_parents[i] = this->_parent_handles[i] == invalid_id ? no_node : this->_index[this->_parent_handles[i]];
+	}
+	// parents may have changed anywhere, so every tree is stale and has its world transforms recomputed once
+	this->_changed.assign(count, 0);
+	this->_built = true;
+}
+
+template <mv::uint dims>
+mv::size_type mv::TransformHierarchy<dims>::tree_count() const
+{
+	return static_cast<size_type>(this->_trees.size());
+}
+
+template <mv::uint dims>
+typename mv::TransformHierarchy<dims>::handle_type mv::TransformHierarchy<dims>::root(size_type tree) const
+{
+	return this->_handles[this->_trees[tree].begin];
+}
+
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::propagate()
+{
+	this->build();
+	for (size_type tree = 0; tree < this->_trees.size(); ++tree) {
+		this->_propagate(tree);
+	}
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::_set_world(uint i, const transform_type& world)
+{
+	uint parent = this->_parents[i];
+	this->_locals[i] = parent == no_node ? world : decompose(this->_worlds[parent], world);
+	this->_dirty[i] = 1;
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::_unlink(uint i)
+{
+	if (this->_parent_handles[i] == invalid_id) {
+		return;
+	}
+	std::vector<handle_type>& siblings = this->_children[this->_index[this->_parent_handles[i]]];
+	auto it = std::find(siblings.begin(), siblings.end(), this->_handles[i]);
+	*it = siblings.back();
+	siblings.pop_back();
+}
+
+template <mv::uint dims>
+void mv::TransformHierarchy<dims>::_propagate(size_type tree)
+{
+	Tree& t = this->_trees[tree];
+	for (uint i = t.begin; i < t.end; ++i) {
+		uint parent = this->_parents[i];
+		// a node changes with its own local transform or with its parent, parents are always visited first
+		bool changed = t.stale || this->_dirty[i] || (parent != no_node && this->_changed[parent]);
+		this->_changed[i] = changed;
+		this->_dirty[i] = 0;
+		if (!changed) {
+			continue;
+		}
+		this->_worlds[i] = parent == no_node ? this->_locals[i] : compose(this->_worlds[parent], this->_matrices[parent], this->_locals[i]);
+		this->_matrices[i] = this->_worlds[i].transform_matrix();
+	}
+	t.stale = false;
+}
+
+
+template class mv::TransformHierarchy<2>;
+template class mv::TransformHierarchy<3>;
@@ -0,0 +1,145 @@
+#pragma once
+#include "setup.h"
+
+#include <vector>
+
+#include "Matrix.h"
+#include "Transform.h"
+
+namespace mv
+{
+	/**
+		\brief parent and child relations between transforms, with world transforms derived from local ones
+
+		Nodes are identified by handles chosen by the user, e.g. entity ids, and stored in arrays sorted into trees:
+		every tree is one contiguous range of nodes in breadth-first order, so parents always come before their children
+		and a tree is brought up to date by a single pass over its range. Trees share no nodes, so they can be
+		propagated in parallel. Only nodes whose local transform changed, and the subtrees below them, are recomputed.
+
+		World transforms apply the scale, rotation and translation of the parent to those of the child. A parent with
+		a non-uniform scale would shear a rotated child, which a transform cannot hold, so such shear is dropped.
+	*/
+	template <uint dims>
+	class TransformHierarchy
+	{
+	public:
+		using transform_type = Transform<dims>;
+		using matrix_type = Matrix<float, dims + 1, dims + 1>;
+		using handle_type = id_type;
+
+	private:
+		struct Tree
+		{
+			uint begin;
+			uint end;
+			bool stale; // sorted since the last propagation, so every world transform is recomputed
+		};
+
+		static constexpr uint no_node = static_cast<uint>(-1);
+
+		std::vector<uint> _index; // maps handle to node index, no_node for handles not in the hierarchy
+		std::vector<handle_type> _handles;
+		std::vector<handle_type> _parent_handles; // invalid_id for roots
+		std::vector<std::vector<handle_type>> _children; // kept up to date with _parent_handles, so no lookup scans every node
+		std::vector<uint> _parents; // node index of the parent, valid once built
+		std::vector<transform_type> _locals;
+		std::vector<transform_type> _worlds;
+		std::vector<matrix_type> _matrices; // transform_matrix() of each world transform, placing the children
+		std::vector<byte> _dirty; // local transform set since the last propagation, kept through build
+		std::vector<byte> _changed; // world transform recomputed in the last propagation
+		std::vector<Tree> _trees;
+		bool _built;
+
+	public:
+		TransformHierarchy();
+
+		/**
+			\brief add a node without parent
+		*/
+		void add(handle_type node, const transform_type& local);
+		/**
+			\brief remove a node, its children become roots that keep their last world transform
+		*/
+		void remove(handle_type node);
+		/**
+			\brief remove a node if it has neither parent nor children, such a node would only be propagated as a tree of its own
+		*/
+		void prune(handle_type node);
+		bool contains(handle_type node) const;
+		/**
+			\brief append the children of a node to out
+		*/
+		void children(handle_type node, std::vector<handle_type>& out) const;
+
+		/**
+			\brief set the parent of a node, invalid_id makes it a root
+
+			Throws if either node is not in the hierarchy or if parent is the node or below it. All other accessors
+			throw for nodes not in the hierarchy as well.
+		*/
+		void set_parent(handle_type node, handle_type parent);
+		/**
+			\brief get the parent of a node, invalid_id for roots
+		*/
+		handle_type parent(handle_type node) const;
+
+		void set_local(handle_type node, const transform_type& local);
+		/**
+			\brief set the local transform of a node so that its world transform becomes world
+
+			The local transform is taken relative to the world transform the parent had at the last propagation.
+		*/
+		void set_world(handle_type node, const transform_type& world);
+		const transform_type& local(handle_type node) const;
+		/**
+			\brief get the world transform of a node as of the last propagation
+		*/
+		const transform_type& world(handle_type node) const;
+		const matrix_type& world_matrix(handle_type node) const;
+
+		/**
+			\brief sort the nodes into trees after nodes were added, removed or given another parent
+
+			Needs to be called before trees are propagated, does nothing if the structure did not change.
+		*/
+		void build();
+		size_type tree_count() const;
+		handle_type root(size_type tree) const;
+
+		/**
+			\brief take over the world transforms of the nodes of one tree that were moved outside the hierarchy
+			\param source callable as const transform_type&(handle_type), the current world transform of a node
+
+			Roots take their source as local transform. Other nodes whose source differs from their world transform as of
+			the last propagation get their local transform derived from it, see set_world, unless their local transform
+			was set since then. The tree has to be built.
+		*/
+		template <typename Source>
+		void sync(size_type tree, Source&& source);
+		/**
+			\brief bring the world transforms of all trees up to date
+		*/
+		void propagate();
+		/**
+			\brief bring the world transforms of one tree up to date
+			\param visitor callable as void(handle_type, const transform_type&), called for every node below the root
+				whose world transform changed, in breadth-first order
+		*/
+		template <typename Visitor>
+		void propagate(size_type tree, Visitor&& visitor);
+
+	private:
+		void _set_world(uint i, const transform_type& world);
+		/**
+			\brief take a node out of the children of its parent, if it has one
+		*/
+		void _unlink(uint i);
+		void _propagate(size_type tree);
+	};
+
+
+	using TransformHierarchy2D = TransformHierarchy<2>;
+	using TransformHierarchy3D = TransformHierarchy<3>;
+}
+
+#include "TransformHierarchy.inl"
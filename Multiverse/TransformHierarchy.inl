@@ -0,0 +1,34 @@
+#include "TransformHierarchy.h"
+
+
+template <mv::uint dims>
+template <typename Source>
+inline void mv::TransformHierarchy<dims>::sync(size_type tree, Source&& source)
+{
+	const Tree& t = this->_trees[tree];
+	for (uint i = t.begin; i < t.end; ++i) {
+		const transform_type& world = source(this->_handles[i]);
+		if (this->_parents[i] == no_node) {
+			// a root is placed by its source alone, even over a local transform set since the last propagation
+			if (!(world == this->_locals[i])) {
+				this->_set_world(i, world);
+			}
+		}
+		else if (!this->_dirty[i] && !(world == this->_worlds[i])) {
+			this->_set_world(i, world);
+		}
+	}
+}
+
+template <mv::uint dims>
+template <typename Visitor>
+inline void mv::TransformHierarchy<dims>::propagate(size_type tree, Visitor&& visitor)
+{
+	this->_propagate(tree);
+	const Tree& t = this->_trees[tree];
+	for (uint i = t.begin + 1; i < t.end; ++i) {
+		if (this->_changed[i]) {
+			visitor(this->_handles[i], this->_worlds[i]);
+		}
+	}
+}
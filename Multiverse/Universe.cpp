@@ -1,14 +1,40 @@
 #include "MultiversePCH.h"
 #include "Universe.h"
 
-#include <algorithm> // find
+#include <algorithm> // copy, find, find_if, max, min, sort
+#include <initializer_list>
 #include <cmath>
+#include <stdexcept> // logic_error, runtime_error
 
 #include "Entity.h"
 #include "Multiverse.h"
 #include "Component.h"
 #include "ThreadPool.h"
 
+namespace
+{
+	// collects query results into a caller provided array
+	template <mv::uint dims>
+	struct QueryOutput
+	{
+		mv::Entity<dims>** out;
+		mv::size_type capacity;
+		mv::size_type count;
+
+		static bool push(void* context, mv::Entity<dims>& entity)
+		{
+			QueryOutput<dims>& output = *static_cast<QueryOutput<dims>*>(context);
+			output.out[output.count++] = &entity;
+			return output.count < output.capacity;
+		}
+
+		static bool push_ray(void* context, mv::Entity<dims>& entity, float)
+		{
+			return push(context, entity);
+		}
+	};
+}
+
 template <mv::uint dims>
 template <mv::UpdateStage stage>
 mv::Universe<dims>::ComponentUpdaterList<stage>::ComponentUpdaterList(ComponentUpdaterList<stage>&& other) noexcept
@@ -68,26 +94,44 @@ template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
 mv::Universe<dims>::Gridspace::Gridspace(
 	mv::uint cell_count_x, mv::uint cell_count_y, float cell_size_x, float cell_size_y)
 	: _cells{ new Cell[cell_count_x * cell_count_y]{} },
-	_cell_counts{ cell_count_x, cell_count_y }, _cell_sizes{ cell_size_x, cell_size_y }
-{}
+	_cell_counts{ cell_count_x, cell_count_y }, _cell_sizes{ cell_size_x, cell_size_y },
+	_migrations(cell_count_y), _sweeps(cell_count_y), _tick{ 1 }
+{
+	for (CollisionLayerMask& interactions : this->_layer_interactions) {
+		interactions = all_collision_layers;
+	}
+}
 
 template <mv::uint dims>
 template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
 mv::Universe<dims>::Gridspace::Gridspace(
 	mv::uint cell_count_x, mv::uint cell_count_y, mv::uint cell_count_z, float cell_size_x, float cell_size_y, float cell_size_z)
 	: _cells{ new Cell[cell_count_x * cell_count_y * cell_count_z]{} },
-	_cell_counts{ cell_count_x, cell_count_y, cell_count_z }, _cell_sizes{ cell_size_x, cell_size_y, cell_size_z }
-{}
+	_cell_counts{ cell_count_x, cell_count_y, cell_count_z }, _cell_sizes{ cell_size_x, cell_size_y, cell_size_z },
+	_migrations(cell_count_z), _sweeps(cell_count_z), _tick{ 1 }
+{
+	for (CollisionLayerMask& interactions : this->_layer_interactions) {
+		interactions = all_collision_layers;
+	}
+}
 
 template <mv::uint dims>
 mv::Universe<dims>::Gridspace::Gridspace(Gridspace&& other) noexcept
-	: _cells{ other._cells }, _cell_counts{}, _cell_sizes{}
+	: _cells{ other._cells }, _cell_counts{}, _cell_sizes{}, _migrations{ std::move(other._migrations) },
+	_sweeps{ std::move(other._sweeps) }, _sweep_ids{ std::move(other._sweep_ids) }, _sweep_tois{ std::move(other._sweep_tois) },
+	_woken_entity_ids{ std::move(other._woken_entity_ids) }, _wake_mutex{}, _stripe_contacts{ std::move(other._stripe_contacts) },
+	_contacts{ std::move(other._contacts) }, _overlaps{ std::move(other._overlaps) },
+	_previous_overlaps{ std::move(other._previous_overlaps) }, _overlap_events{ std::move(other._overlap_events) },
+	_wide_entity_ids{ std::move(other._wide_entity_ids) }, _tick{ other._tick }
 {
 	other._cells = nullptr;
 	for (uint i = 0; i < dims; ++i) {
 		this->_cell_counts[i] = other._cell_counts[i];
 		this->_cell_sizes[i] = other._cell_sizes[i];
 	}
+	for (uint i = 0; i < 8; ++i) {
+		this->_layer_interactions[i] = other._layer_interactions[i];
+	}
 }
 
 
@@ -105,12 +149,28 @@ typename mv::Universe<dims>::Gridspace& mv::Universe<dims>::Gridspace::operator=
 	if (this == &other)
 		return *this;
 
+	delete[] this->_cells;
 	this->_cells = other._cells;
 	other._cells = nullptr;
 	for (uint i = 0; i < dims; ++i) {
 		this->_cell_counts[i] = other._cell_counts[i];
 		this->_cell_sizes[i] = other._cell_sizes[i];
 	}
+	this->_migrations = std::move(other._migrations);
+	this->_sweeps = std::move(other._sweeps);
+	this->_sweep_ids = std::move(other._sweep_ids);
+	this->_sweep_tois = std::move(other._sweep_tois);
+	this->_woken_entity_ids = std::move(other._woken_entity_ids);
+	this->_stripe_contacts = std::move(other._stripe_contacts);
+	this->_contacts = std::move(other._contacts);
+	this->_overlaps = std::move(other._overlaps);
+	this->_previous_overlaps = std::move(other._previous_overlaps);
+	this->_overlap_events = std::move(other._overlap_events);
+	this->_wide_entity_ids = std::move(other._wide_entity_ids);
+	this->_tick = other._tick;
+	for (uint i = 0; i < 8; ++i) {
+		this->_layer_interactions[i] = other._layer_interactions[i];
+	}
 
 	return *this;
 }
@@ -120,14 +180,15 @@ template <mv::uint dims>
 void mv::Universe<dims>::Gridspace::add(id_type entity_id)
 {
 	Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
-	uint cell = this->_calculate_cell(e.get_transform().translate);
+	uint cell = this->_calculate_cell(e._latest_transform().translate);
 	e._gridspace_cell_idx = cell;
+	e._update_placements(this->_tick);
 	if (e.is_static()) {
-		this->_cells[cell].static_entity_ids.push_back(entity_id);
+		this->_add_static(this->_cells[cell], e);
 	}
 	else {
 		this->_cells[cell].dynamic_entity_ids.push_back(entity_id);
-		++this->_cells[cell].count;
+		this->_cells[cell].dynamic_layers |= e._collision_layers;
 	}
 }
 
@@ -136,157 +197,791 @@ void mv::Universe<dims>::Gridspace::remove(id_type entity_id)
 {
 	Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
 	uint cell = e._gridspace_cell_idx;
-	std::vector<id_type>& vec = e.is_static() ? this->_cells[cell].static_entity_ids : this->_cells[cell].dynamic_entity_ids;
-	auto it = std::find(vec.begin(), vec.end(), entity_id);
-	*it = vec.back();
-	vec.pop_back();
-	if (!e.is_static()) {
-		--this->_cells[cell].count;
+	StaticGroup* group = nullptr;
+	StaticEntry* entry = e.is_static() ? _find_static(this->_cells[cell], entity_id, group) : nullptr;
+	if (entry) {
+		this->_remove_static(this->_cells[cell], *group, *entry);
+	}
+	else {
+		std::vector<id_type>* vec = e.is_static() ? &this->_wide_entity_ids : &this->_cells[cell].dynamic_entity_ids;
+		auto it = std::find(vec->begin(), vec->end(), entity_id);
+		if (it == vec->end()) { // asleep, or woken but not yet moved out of the sleeping list
+			vec = &this->_cells[cell].sleeping_entity_ids;
+			it = std::find(vec->begin(), vec->end(), entity_id);
+		}
+		*it = vec->back();
+		vec->pop_back();
+		if (vec == &this->_cells[cell].sleeping_entity_ids) {
+			this->_cells[cell].sleeping_layers = this->_layers(*vec);
+		}
+	}
+
+	// the entity leaves every overlap it was part of right away, the other side gets its end event now
+	auto overlaps_end = std::remove_if(this->_overlaps.begin(), this->_overlaps.end(), [entity_id](const Overlap& overlap) {
+		return overlap.key.entity0 == entity_id || overlap.key.entity1 == entity_id;
+	});
+	std::vector<Overlap> ended(overlaps_end, this->_overlaps.end());
+	this->_overlaps.erase(overlaps_end, this->_overlaps.end());
+	for (const Overlap& overlap : ended) {
+		if (overlap.key.entity0 == entity_id && overlap.sides & 0b10u) {
+			mv::Multiverse::entity<dims>(overlap.key.entity1)._colliders[overlap.key.collider1]._raise_overlap(entity_id, false);
+		}
+		else if (overlap.key.entity1 == entity_id && overlap.sides & 0b01u) {
+			mv::Multiverse::entity<dims>(overlap.key.entity0)._colliders[overlap.key.collider0]._raise_overlap(entity_id, false);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(this->_wake_mutex);
+	auto woken_it = std::find(this->_woken_entity_ids.begin(), this->_woken_entity_ids.end(), entity_id);
+	if (woken_it != this->_woken_entity_ids.end()) {
+		*woken_it = this->_woken_entity_ids.back();
+		this->_woken_entity_ids.pop_back();
 	}
 }
 
+template <mv::uint dims>
+mv::uint mv::Universe<dims>::Gridspace::cell(const position_type& position) const
+{
+	return this->_calculate_cell(position);
+}
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
-void mv::Universe<dims>::Gridspace::update_cells()
+mv::uint mv::Universe<dims>::Gridspace::tick() const
 {
-	for (uint i = 0; i < this->_cell_count(); ++i) {
-		for (uint j = 0; j < this->_cells[i].count; ++j) {
-			Entity<2>& e = mv::Multiverse::entity<2>(this->_cells[i].dynamic_entity_ids[j]);
-			uint new_cell = this->_calculate_cell(e._transform.translate);
-			e._gridspace_cell_idx = new_cell;
-			if (new_cell != i) {
-				this->_cells[new_cell].dynamic_entity_ids.push_back(this->_cells[i].dynamic_entity_ids[j]);
-				this->_cells[i].dynamic_entity_ids[j] = this->_cells[i].dynamic_entity_ids.back();
-				this->_cells[i].dynamic_entity_ids.pop_back();
-				--this->_cells[i].count;
-				--j;
-				if (new_cell < i) {
-					++this->_cells[new_cell].count;
-				}
+	return this->_tick;
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::wake(Entity<dims>& entity)
+{
+	// may be called from parallel collision and component updates, awake entities return without taking the lock
+	if (!entity._sleeping)
+		return;
+	std::lock_guard<std::mutex> lock(this->_wake_mutex);
+	if (!entity._sleeping)
+		return;
+	entity._sleeping = false;
+	entity._motion->rest_ticks = 0;
+	this->_woken_entity_ids.push_back(entity.id());
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::update_colliders(Entity<dims>& entity)
+{
+	// the entity may be in any list of its cell, so each list that could hold it keeps the new layers
+	std::lock_guard<std::mutex> lock(this->_wake_mutex);
+	Cell& cell = this->_cells[entity._gridspace_cell_idx];
+	if (entity.is_static()) {
+		bool wide = false;
+		for (const Collider<dims>& collider : entity._colliders) {
+			for (uint i = 0; i < dims; ++i) {
+				wide = wide || collider._placement.upper[i] - collider._placement.lower[i] > this->_cell_sizes[i];
 			}
-			e._transform_buffer = e._transform;
 		}
-		this->_cells[i].count = static_cast<uint>(this->_cells[i].dynamic_entity_ids.size());
+		StaticGroup* group = nullptr;
+		StaticEntry* entry = _find_static(cell, entity.id(), group);
+		if (!entry) {
+			return; // already wide
+		}
+		if (wide) {
+			this->_remove_static(cell, *group, *entry);
+			this->_wide_entity_ids.push_back(entity.id());
+			entity._wide = true;
+		}
+		else {
+			entry->layers = entity._collision_layers;
+			cell.static_layers |= entity._collision_layers;
+		}
+	}
+	else {
+		cell.dynamic_layers |= entity._collision_layers;
+		cell.sleeping_layers |= entity._collision_layers;
 	}
 }
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
-void mv::Universe<dims>::Gridspace::update_cells()
+void mv::Universe<dims>::Gridspace::set_layer_interaction(CollisionLayer layer0, CollisionLayer layer1, bool interact)
 {
+	CollisionLayerMask& interactions0 = this->_layer_interactions[static_cast<byte>(layer0)];
+	CollisionLayerMask& interactions1 = this->_layer_interactions[static_cast<byte>(layer1)];
+	if (interact) {
+		interactions0 |= collision_layer_mask(layer1);
+		interactions1 |= collision_layer_mask(layer0);
+	}
+	else {
+		interactions0 &= static_cast<CollisionLayerMask>(~collision_layer_mask(layer1));
+		interactions1 &= static_cast<CollisionLayerMask>(~collision_layer_mask(layer0));
+	}
+}
 
+template <mv::uint dims>
+mv::CollisionLayerMask mv::Universe<dims>::Gridspace::layer_interactions(CollisionLayer layer) const
+{
+	return this->_layer_interactions[static_cast<byte>(layer)];
 }
 
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
-void mv::Universe<dims>::Gridspace::update_collision() const
+void mv::Universe<dims>::Gridspace::update_cells()
 {
-	float radius = this->_cell_sizes[0]; // bad value for scan radius, obviously will miss some objects larger than a cell
-	float sqr_radius = radius * radius;
-	for (uint i = 0; i < this->_cell_count(); ++i) {
-		for (uint j = 0; j < this->_cells[i].count; ++j) {
-			Entity<2>& a = mv::Multiverse::entity<2>(this->_cells[i].dynamic_entity_ids[j]);
-			auto origin = a._transform.translate;
-			uint xmin, xmax, ymin, ymax;
-			if (radius * 2.f < this->_cell_sizes[0] * static_cast<float>(this->_cell_counts[0] - 1)) {
-				xmin = this->_calculate_grid_coord(origin.x() - radius, 0);
-				xmax = this->_calculate_grid_coord(origin.x() + radius, 0) + 1;
-			}
-			else {
-				xmin = 0;
-				xmax = this->_cell_counts[0];
-			}
-			if (radius * 2.f < this->_cell_sizes[1] * static_cast<float>(this->_cell_counts[1] - 1)) {
-				ymin = this->_calculate_grid_coord(origin.y() - radius, 1);
-				ymax = this->_calculate_grid_coord(origin.y() + radius, 1) + 1;
-			}
-			else {
-				ymin = 0;
-				ymax = this->_cell_counts[1];
+	this->_apply_wakes();
+
+	// advancing the tick makes the latest transform of every entity its snapshot, entities written in the tick
+	// that ended still hold the previous snapshot in their other slot
+	uint written_tick = this->_tick++;
+
+	// rows only write to their own cells, entities leaving a cell are collected per row and moved afterwards
+	uint row_size = this->_row_size();
+	mv::Multiverse::thread_pool().parallel_for(this->_row_count(), [this, row_size, written_tick](size_type row) {
+		std::vector<Migration>& migrations = this->_migrations[row];
+		std::vector<id_type>& sweeps = this->_sweeps[row];
+		migrations.clear();
+		sweeps.clear();
+		for (uint i = static_cast<uint>(row) * row_size; i < static_cast<uint>(row + 1) * row_size; ++i) {
+			std::vector<id_type>& ids = this->_cells[i].dynamic_entity_ids;
+			CollisionLayerMask dynamic_layers = 0; // rebuilt from the entities that stay, migrations add theirs afterwards
+			for (uint j = 0; j < ids.size(); ++j) {
+				Entity<dims>& e = mv::Multiverse::entity<dims>(ids[j]);
+				const transform_type& transform = e._latest_transform();
+				const transform_type& previous = e._snapshot_transform(written_tick);
+				bool moved = e._written_in(written_tick) && !(transform == previous);
+				if (!moved && !e._motion->has_velocity) {
+					e._motion->sweep = position_type{};
+					if (++e._motion->rest_ticks >= MV_SLEEP_TICKS && this->_sleep(e)) {
+						// not moved, so it stays in this cell
+						this->_cells[i].sleeping_entity_ids.push_back(ids[j]);
+						this->_cells[i].sleeping_layers |= e._collision_layers;
+						ids[j] = ids.back();
+						ids.pop_back();
+						--j;
+					}
+					else {
+						dynamic_layers |= e._collision_layers;
+					}
+					continue;
+				}
+				e._motion->rest_ticks = 0;
+
+				uint new_cell = this->_calculate_cell(transform.translate);
+				e._gridspace_cell_idx = new_cell;
+				e._motion->sweep = moved ? transform.translate - previous.translate : position_type{};
+				e._update_placements(this->_tick);
+				if (e._continuous && e._motion->sweep != position_type{}) {
+					sweeps.push_back(ids[j]);
+				}
+				if (new_cell != i) {
+					migrations.push_back(Migration{ ids[j], new_cell, e._collision_layers });
+					ids[j] = ids.back();
+					ids.pop_back();
+					--j;
+				}
+				else {
+					dynamic_layers |= e._collision_layers;
+				}
 			}
+			this->_cells[i].dynamic_layers = dynamic_layers;
+		}
+	});
 
-			for (uint y = ymin; y != ymax; y = (y + 1) % this->_cell_counts[1]) {
-				for (uint x = xmin; x != xmax; x = (x + 1) % this->_cell_counts[0]) {
-					for (id_type entity_id : this->_cells[x + this->_cell_counts[0] * y].static_entity_ids) {
-						Entity<2>& b = mv::Multiverse::entity<2>(entity_id);
-						if ((b.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
-							a._solve_collision(b);
+	// applied in row order so cell contents do not depend on the amount of threads
+	for (const std::vector<Migration>& migrations : this->_migrations) {
+		for (const Migration& migration : migrations) {
+			this->_cells[migration.cell].dynamic_entity_ids.push_back(migration.entity_id);
+			this->_cells[migration.cell].dynamic_layers |= migration.layers;
+		}
+	}
+
+	this->_sweep_continuous();
+}
+
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::update_collision()
+{
+	float radius = this->_scan_radius();
+	float sqr_radius = radius * radius;
+	uint stripe_count = this->_stripe_count();
+	uint row_size = this->_row_size();
+
+	this->_stripe_contacts.resize(stripe_count);
+
+	auto solve_stripe = [this, radius, sqr_radius, stripe_count, row_size](size_type stripe) {
+		StripeContacts& contacts = this->_stripe_contacts[stripe];
+		contacts.batch.clear();
+		contacts.keys.clear();
+		contacts.sides.clear();
+		contacts.overlaps.clear();
+		auto queue = [this, &contacts](Entity<dims>& a, Entity<dims>& b) {
+			a._queue_collision(b, this->_layer_interactions, contacts.batch, contacts.keys, contacts.sides);
+		};
+
+		uint first_row, last_row;
+		this->_stripe_rows(static_cast<uint>(stripe), stripe_count, first_row, last_row);
+		for (uint i = first_row * row_size; i < last_row * row_size; ++i) {
+			for (id_type a_id : this->_cells[i].dynamic_entity_ids) {
+				Entity<dims>& a = mv::Multiverse::entity<dims>(a_id);
+				CollisionLayerMask a_layers = a._interaction_layers(this->_layer_interactions);
+				if (!a_layers) {
+					continue; // no collider interacts with anything, e.g. decoration
+				}
+				position_type origin = a._snapshot_transform(this->_tick).translate;
+				this->_for_each_cell(origin, radius, [this, &a, a_id, a_layers, &origin, sqr_radius, &queue](uint cell) {
+					const Cell& c = this->_cells[cell];
+					if (c.static_layers & a_layers) {
+						// static entities are only looked up once their compact entry is in reach
+						this->_for_each_static(c, [a_layers, &origin, sqr_radius, &a, &queue](const StaticEntry& entry, const position_type& position) {
+							if ((entry.layers & a_layers) && (position - origin).squared_magnitude() < sqr_radius) {
+								queue(a, mv::Multiverse::entity<dims>(entry.entity_id));
+							}
+							return true;
+						});
+					}
+					if (c.sleeping_layers & a_layers) {
+						for (id_type b_id : c.sleeping_entity_ids) {
+							Entity<dims>& b = mv::Multiverse::entity<dims>(b_id);
+							if ((b._collision_layers & a_layers) && (b.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
+								queue(a, b);
+							}
 						}
 					}
-					for (id_type entity_id : this->_cells[x + this->_cell_counts[0] * y].dynamic_entity_ids) {
-						Entity<2>& b = mv::Multiverse::entity<2>(entity_id);
-						if (entity_id < b.id()) {
+					if (!(c.dynamic_layers & a_layers)) {
+						return true;
+					}
+					for (id_type b_id : c.dynamic_entity_ids) {
+						if (b_id <= a_id) {
 							continue; // only check each pair once
 						}
-						if ((b.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
-							a._solve_collision(b);
+						Entity<dims>& b = mv::Multiverse::entity<dims>(b_id);
+						if ((b._collision_layers & a_layers) && (b.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
+							queue(a, b);
 						}
 					}
+					return true;
+				});
+				for (id_type b_id : this->_wide_entity_ids) {
+					Entity<dims>& b = mv::Multiverse::entity<dims>(b_id);
+					if (b._collision_layers & a_layers) {
+						queue(a, b);
+					}
 				}
 			}
 		}
-	}	
+
+		// blocking pairs in contact in the last update start from its support hints and correction
+		contacts.cached.clear();
+		for (size_type i = 0; i < contacts.batch.size(); ++i) {
+			const Contact<dims>* cached = contacts.sides[i] ? nullptr : find_contact(this->_contacts, contacts.keys[i]);
+			if (cached) {
+				contacts.batch.warm_start(i, cached->hints);
+			}
+			contacts.cached.push_back(cached);
+		}
+
+		// narrow phase only reads placements, so all pairs are tested at once before any entity is moved
+		contacts.batch.solve();
+		for (size_type i = 0; i < contacts.batch.size(); ++i) {
+			if (contacts.sides[i] && contacts.batch.hit(i)) {
+				contacts.overlaps.push_back(Overlap{ contacts.keys[i], contacts.sides[i] });
+			}
+		}
+		this->_solve_contacts(contacts);
+	};
+
+	// stripes of the same colour never touch the same entities, so each colour is solved in parallel
+	std::vector<size_type> stripes;
+	stripes.reserve(stripe_count);
+	for (uint colour = 0; colour < 3; ++colour) {
+		stripes.clear();
+		for (uint stripe = 0; stripe < stripe_count; ++stripe) {
+			if (this->_stripe_colour(stripe, stripe_count) == colour) {
+				stripes.push_back(stripe);
+			}
+		}
+		mv::Multiverse::thread_pool().parallel_for(stripes.size(), [&solve_stripe, &stripes](size_type i) {
+			solve_stripe(stripes[i]);
+		});
+	}
+
+	this->_contacts.clear();
+	for (const StripeContacts& contacts : this->_stripe_contacts) {
+		for (const SolverContact& contact : contacts.contacts) {
+			this->_contacts.push_back(contact.contact);
+		}
+	}
+	std::sort(this->_contacts.begin(), this->_contacts.end(), [](const Contact<dims>& lhs, const Contact<dims>& rhs) {
+		return lhs.key < rhs.key;
+	});
+
+	// buffers are swapped rather than reallocated, so a steady amount of overlaps does not allocate
+	std::swap(this->_overlaps, this->_previous_overlaps);
+	this->_overlaps.clear();
+	for (const StripeContacts& contacts : this->_stripe_contacts) {
+		this->_overlaps.insert(this->_overlaps.end(), contacts.overlaps.begin(), contacts.overlaps.end());
+	}
+	std::sort(this->_overlaps.begin(), this->_overlaps.end(), [](const Overlap& lhs, const Overlap& rhs) {
+		return lhs.key < rhs.key;
+	});
+	this->_overlaps.erase(std::unique(this->_overlaps.begin(), this->_overlaps.end(), [](const Overlap& lhs, const Overlap& rhs) {
+		return lhs.key == rhs.key;
+	}), this->_overlaps.end());
 }
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
-void mv::Universe<dims>::Gridspace::update_collision() const
-{}
+void mv::Universe<dims>::Gridspace::dispatch_collision_events()
+{
+	// both lists are sorted, so a single merge finds every pair that began or ended
+	std::vector<OverlapEvent>& events = this->_overlap_events;
+	events.clear();
+	auto previous = this->_previous_overlaps.cbegin();
+	auto current = this->_overlaps.cbegin();
+	while (previous != this->_previous_overlaps.cend() || current != this->_overlaps.cend()) {
+		if (current == this->_overlaps.cend() || (previous != this->_previous_overlaps.cend() && previous->key < current->key)) {
+			events.push_back(OverlapEvent{ *previous, false });
+			++previous;
+		}
+		else if (previous == this->_previous_overlaps.cend() || current->key < previous->key) {
+			events.push_back(OverlapEvent{ *current, true });
+			++current;
+		}
+		else {
+			// same pair, but a response may have changed on one side
+			byte ended = static_cast<byte>(previous->sides & ~current->sides);
+			byte begun = static_cast<byte>(current->sides & ~previous->sides);
+			if (ended) {
+				events.push_back(OverlapEvent{ Overlap{ previous->key, ended }, false });
+			}
+			if (begun) {
+				events.push_back(OverlapEvent{ Overlap{ current->key, begun }, true });
+			}
+			++previous;
+			++current;
+		}
+	}
+
+	// callbacks run once all events are known, so they are free to change the gridspace
+	for (const OverlapEvent& event : events) {
+		const ContactKey& key = event.overlap.key;
+		if (event.overlap.sides & 0b01u) {
+			mv::Multiverse::entity<dims>(key.entity0)._colliders[key.collider0]._raise_overlap(key.entity1, event.begin);
+		}
+		if (event.overlap.sides & 0b10u) {
+			mv::Multiverse::entity<dims>(key.entity1)._colliders[key.collider1]._raise_overlap(key.entity0, event.begin);
+		}
+	}
+	for (const Contact<dims>& contact : this->_contacts) {
+		mv::Multiverse::entity<dims>(contact.key.entity0)._colliders[contact.key.collider0]._raise_hit(contact);
+		mv::Multiverse::entity<dims>(contact.key.entity1)._colliders[contact.key.collider1]._raise_hit(contact);
+	}
+}
 
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
-std::vector<mv::Entity<2>*> mv::Universe<dims>::Gridspace::entities_in_range(const position_type& origin, float radius) const
+void mv::Universe<dims>::Gridspace::query_radius(
+	const position_type& origin, float radius, CollisionLayerMask layers, visitor_type visitor, void* context) const
+{
+	float sqr_radius = radius * radius;
+	bool completed = this->_for_each_cell(origin, radius, [this, &origin, sqr_radius, layers, visitor, context](uint cell) {
+		bool statics_completed = this->_for_each_static(this->_cells[cell],
+			[this, &origin, sqr_radius, layers, visitor, context](const StaticEntry& entry, const position_type& position) {
+			return !((position - origin).squared_magnitude() < sqr_radius && this->_matches(entry, layers)) ||
+				visitor(context, mv::Multiverse::entity<dims>(entry.entity_id));
+		});
+		if (!statics_completed) {
+			return false;
+		}
+		for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+			for (id_type entity_id : *ids) {
+				Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+				if ((e._snapshot_transform(this->_tick).translate - origin).squared_magnitude() < sqr_radius &&
+					this->_matches(e, layers) && !visitor(context, e)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	});
+	if (!completed)
+		return;
+	for (id_type entity_id : this->_wide_entity_ids) {
+		Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+		if ((this->_wide_closest(e, origin) - origin).squared_magnitude() < sqr_radius && this->_matches(e, layers) && !visitor(context, e)) {
+			return;
+		}
+	}
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::query_box(
+	const position_type& lower, const position_type& upper, CollisionLayerMask layers, visitor_type visitor, void* context) const
 {
-	static std::vector<mv::Entity<2>*> retval;
+	auto inside = [&lower, &upper](const position_type& position) {
+		for (uint i = 0; i < dims; ++i) {
+			if (position[i] < lower[i] || upper[i] < position[i])
+				return false;
+		}
+		return true;
+	};
+	bool completed = this->_for_each_cell(lower, upper, [this, &inside, layers, visitor, context](uint cell) {
+		bool statics_completed = this->_for_each_static(this->_cells[cell],
+			[this, &inside, layers, visitor, context](const StaticEntry& entry, const position_type& position) {
+			return !(inside(position) && this->_matches(entry, layers)) || visitor(context, mv::Multiverse::entity<dims>(entry.entity_id));
+		});
+		if (!statics_completed) {
+			return false;
+		}
+		for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+			for (id_type entity_id : *ids) {
+				Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+				if (inside(e._snapshot_transform(this->_tick).translate) && this->_matches(e, layers) && !visitor(context, e)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	});
+	if (!completed)
+		return;
+	// the point of the bounds closest to the centre of the box lies inside it exactly when the bounds overlap the box
+	position_type centre = (lower + upper) * 0.5f;
+	for (id_type entity_id : this->_wide_entity_ids) {
+		Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+		if (inside(this->_wide_closest(e, centre)) && this->_matches(e, layers) && !visitor(context, e)) {
+			return;
+		}
+	}
+}
 
-	uint xmin, xmax, ymin, ymax;
-	if (radius * 2.f < this->_cell_sizes[0] * static_cast<float>(this->_cell_counts[0] - 1)) {
-		xmin = this->_calculate_grid_coord(origin.x() - radius, 0);
-		xmax = this->_calculate_grid_coord(origin.x() + radius, 0) + 1;
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::query_ray(const position_type& origin, const position_type& direction, float length, float thickness,
+	CollisionLayerMask layers, ray_visitor_type visitor, void* context) const
+{
+	position_type end = origin + direction * length;
+	position_type lower, upper;
+	for (uint i = 0; i < dims; ++i) {
+		lower[i] = std::min(origin[i], end[i]) - thickness;
+		upper[i] = std::max(origin[i], end[i]) + thickness;
 	}
-	else {
-		xmin = 0;
-		xmax = this->_cell_counts[0];
+
+	float sqr_thickness = thickness * thickness;
+	auto within = [&origin, &direction, length, sqr_thickness](const position_type& position, float& distance) {
+		position_type offset = position - origin;
+		distance = std::min(std::max(offset.dot(direction), 0.f), length);
+		return (offset - direction * distance).squared_magnitude() <= sqr_thickness;
+	};
+	bool completed = this->_for_each_cell(lower, upper, [this, &within, layers, visitor, context](uint cell) {
+		float d;
+		bool statics_completed = this->_for_each_static(this->_cells[cell],
+			[this, &within, &d, layers, visitor, context](const StaticEntry& entry, const position_type& position) {
+			return !(within(position, d) && this->_matches(entry, layers)) || visitor(context, mv::Multiverse::entity<dims>(entry.entity_id), d);
+		});
+		if (!statics_completed) {
+			return false;
+		}
+		for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+			for (id_type entity_id : *ids) {
+				Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+				if (within(e._snapshot_transform(this->_tick).translate, d) && this->_matches(e, layers) && !visitor(context, e, d)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	});
+	if (!completed)
+		return;
+	// wide entities are hit where the ray enters their bounds grown by thickness, slab by slab
+	for (id_type entity_id : this->_wide_entity_ids) {
+		Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+		position_type bounds_lower, bounds_upper;
+		this->_wide_bounds(e, bounds_lower, bounds_upper);
+		float enter = 0.f;
+		float exit = length;
+		for (uint i = 0; i < dims && !(exit < enter); ++i) {
+			float slab_lower = bounds_lower[i] - thickness;
+			float slab_upper = bounds_upper[i] + thickness;
+			if (direction[i] == 0.f) {
+				if (origin[i] < slab_lower || slab_upper < origin[i])
+					exit = -1.f;
+				continue;
+			}
+			float t0 = (slab_lower - origin[i]) / direction[i];
+			float t1 = (slab_upper - origin[i]) / direction[i];
+			enter = std::max(enter, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+		if (!(exit < enter) && this->_matches(e, layers) && !visitor(context, e, enter)) {
+			return;
+		}
 	}
-	if (radius * 2.f < this->_cell_sizes[1] * static_cast<float>(this->_cell_counts[1] - 1)) {
-		ymin = this->_calculate_grid_coord(origin.y() - radius, 1);
-		ymax = this->_calculate_grid_coord(origin.y() + radius, 1) + 1;
+}
+
+template <mv::uint dims>
+mv::size_type mv::Universe<dims>::Gridspace::query_nearest(
+	const position_type& origin, size_type k, float max_radius, CollisionLayerMask layers, Entity<dims>** out) const
+{
+	if (k == 0)
+		return 0;
+
+	auto sqr_distance = [this, &origin](const Entity<dims>& e) {
+		return ((e._wide ? this->_wide_closest(e, origin) : e._snapshot_transform(this->_tick).translate) - origin).squared_magnitude();
+	};
+
+	// search growing radii, the k nearest are final once k entities were found within the searched radius
+	size_type count = 0;
+	float radius = std::min(this->_cell_sizes[0], max_radius);
+	while (true) {
+		count = 0;
+		float sqr_radius = radius * radius;
+		auto insert = [this, &sqr_distance, sqr_radius, k, layers, out, &count](Entity<dims>& e) {
+			float d = sqr_distance(e);
+			if (!(d < sqr_radius) || (count == k && !(d < sqr_distance(*out[k - 1]))) || !this->_matches(e, layers))
+				return;
+
+			// insertion into the sorted output, dropping the furthest entity when full
+			size_type i = count < k ? count++ : k - 1;
+			for (; i > 0 && d < sqr_distance(*out[i - 1]); --i) {
+				out[i] = out[i - 1];
+			}
+			out[i] = &e;
+		};
+		this->_for_each_cell(origin, radius, [this, &origin, &insert, sqr_radius, layers](uint cell) {
+			// static entities are ranked by their exact position, the compact entry only rules out those out of reach
+			this->_for_each_static(this->_cells[cell], [this, &origin, &insert, sqr_radius, layers](const StaticEntry& entry, const position_type& position) {
+				if ((position - origin).squared_magnitude() < sqr_radius && this->_matches(entry, layers)) {
+					insert(mv::Multiverse::entity<dims>(entry.entity_id));
+				}
+				return true;
+			});
+			for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+				for (id_type entity_id : *ids) {
+					insert(mv::Multiverse::entity<dims>(entity_id));
+				}
+			}
+			return true;
+		});
+		for (id_type entity_id : this->_wide_entity_ids) {
+			insert(mv::Multiverse::entity<dims>(entity_id));
+		}
+
+		bool covers_grid = true;
+		for (uint i = 0; i < dims; ++i) {
+			covers_grid = covers_grid && !(radius * 2.f < this->_cell_sizes[i] * static_cast<float>(this->_cell_counts[i] - 1));
+		}
+		if (count == k || !(radius < max_radius))
+			return count;
+		// once every cell is visited a larger radius finds no new cells, only the entities rejected by distance, so the last pass uses max_radius
+		radius = covers_grid ? max_radius : std::min(radius * 2.f, max_radius);
 	}
-	else {
-		ymin = 0;
-		ymax = this->_cell_counts[1];
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::cells(const position_type& lower, const position_type& upper, std::vector<uint>& out) const
+{
+	this->_for_each_cell(lower, upper, [&out](uint cell) {
+		out.push_back(cell);
+		return true;
+	});
+	if (!this->_wide_entity_ids.empty()) {
+		out.push_back(wide_cell);
 	}
+}
 
-	float sqr_radius = radius * radius;
-	for (uint y = ymin; y != ymax; y = (y + 1) % this->_cell_counts[1]) {
-		for (uint x = xmin; x != xmax; x = (x + 1) % this->_cell_counts[0]) {
-			for (id_type entity_id : this->_cells[x + this->_cell_counts[0] * y].static_entity_ids) {
-				Entity<2>& e = mv::Multiverse::entity<2>(entity_id);
-				if ((e.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
-					retval.push_back(&e);
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::gather(uint cell, const position_type& centre, std::vector<Entity<dims>*>& entities,
+	std::vector<position_type>& positions, std::vector<CollisionLayerMask>& layers) const
+{
+	if (cell == wide_cell) {
+		for (id_type entity_id : this->_wide_entity_ids) {
+			Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+			entities.push_back(&e);
+			positions.push_back(this->_wide_closest(e, centre));
+			layers.push_back(e._collision_layers);
+		}
+		return;
+	}
+	this->_for_each_static(this->_cells[cell], [&entities, &positions, &layers](const StaticEntry& entry, const position_type& position) {
+		entities.push_back(&mv::Multiverse::entity<dims>(entry.entity_id));
+		positions.push_back(position);
+		layers.push_back(entry.layers);
+		return true;
+	});
+	for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+		for (id_type entity_id : *ids) {
+			Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+			entities.push_back(&e);
+			positions.push_back(e._snapshot_transform(this->_tick).translate);
+			layers.push_back(e._collision_layers);
+		}
+	}
+}
+
+template <mv::uint dims>
+bool mv::Universe<dims>::Gridspace::cast(const CollisionShape<dims>& shape, const typename CollisionShape<dims>::Placement& placement,
+	const position_type& direction, float length, CollisionLayerMask layers, RaycastHit<dims>& hit) const
+{
+	position_type displacement = direction * length;
+	typename CollisionShape<dims>::Placement swept = placement;
+	position_type centre;
+	for (uint i = 0; i < dims; ++i) {
+		swept.lower[i] = std::min(placement.lower[i], placement.lower[i] + displacement[i]);
+		swept.upper[i] = std::max(placement.upper[i], placement.upper[i] + displacement[i]);
+		centre[i] = (placement.lower[i] + placement.upper[i]) * 0.5f;
+	}
+
+	bool found = false;
+	float best_toi = 1.f;
+	auto test = [this, &shape, &placement, &swept, &displacement, layers, &hit, &found, &best_toi](Entity<dims>& e) {
+		if (!this->_matches(e, layers)) {
+			return;
+		}
+		for (uint j = 0; j < e._colliders.size(); ++j) {
+			const Collider<dims>& collider = e._colliders[j];
+			if (!(collision_layer_mask(collider.layer()) & layers) || !swept.overlaps(collider._placement)) {
+				continue;
+			}
+			float toi;
+			position_type normal;
+			if (shape.time_of_impact(collider._shape, placement, displacement, collider._placement, position_type{}, toi, normal) &&
+				(!found || toi < best_toi)) {
+				found = true;
+				best_toi = toi;
+				hit.entity = &e;
+				hit.collider = j;
+				hit.normal = normal;
+			}
+		}
+	};
+	auto test_cell = [this, &test, layers](uint cell) {
+		for (const StaticGroup& group : this->_cells[cell].static_groups) {
+			for (const StaticEntry& entry : group.entries) {
+				if (this->_matches(entry, layers)) {
+					test(mv::Multiverse::entity<dims>(entry.entity_id));
 				}
 			}
-			for (id_type entity_id : this->_cells[x + this->_cell_counts[0] * y].dynamic_entity_ids) {
-				Entity<2>& e = mv::Multiverse::entity<2>(entity_id);
-				if ((e.get_transform().translate - origin).squared_magnitude() < sqr_radius) {
-					retval.push_back(&e);
+		}
+		for (const std::vector<id_type>* ids : { &this->_cells[cell].sleeping_entity_ids, &this->_cells[cell].dynamic_entity_ids }) {
+			for (id_type entity_id : *ids) {
+				test(mv::Multiverse::entity<dims>(entity_id));
+			}
+		}
+		return true;
+	};
+
+	for (id_type entity_id : this->_wide_entity_ids) {
+		test(mv::Multiverse::entity<dims>(entity_id));
+	}
+
+	// entities are binned by position, so colliders reaching a cell of the ray can be binned up to reach cells away
+	int reach[dims];
+	bool covers_grid = false;
+	for (uint i = 0; i < dims; ++i) {
+		float extent = this->_scan_radius() + (placement.upper[i] - placement.lower[i]) * 0.5f;
+		reach[i] = static_cast<int>(std::ceil(extent / this->_cell_sizes[i]));
+		covers_grid = covers_grid || static_cast<uint>(2 * reach[i] + 1) >= this->_cell_counts[i];
+	}
+	if (covers_grid) { // every cell is near the ray, so there is no order to walk them in
+		position_type lower = swept.lower;
+		position_type upper = swept.upper;
+		for (uint i = 0; i < dims; ++i) {
+			lower[i] -= this->_scan_radius();
+			upper[i] += this->_scan_radius();
+		}
+		this->_for_each_cell(lower, upper, test_cell);
+	}
+	else {
+		// Amanatides-Woo traversal, every step enters the next cell along the ray
+		long coord[dims];
+		int step[dims];
+		float t_max[dims];
+		float t_delta[dims];
+		for (uint i = 0; i < dims; ++i) {
+			coord[i] = static_cast<long>(std::floor(centre[i] / this->_cell_sizes[i]));
+			if (direction[i] > 0.f) {
+				step[i] = 1;
+				t_max[i] = (static_cast<float>(coord[i] + 1) * this->_cell_sizes[i] - centre[i]) / direction[i];
+				t_delta[i] = this->_cell_sizes[i] / direction[i];
+			}
+			else if (direction[i] < 0.f) {
+				step[i] = -1;
+				t_max[i] = (static_cast<float>(coord[i]) * this->_cell_sizes[i] - centre[i]) / direction[i];
+				t_delta[i] = -this->_cell_sizes[i] / direction[i];
+			}
+			else {
+				step[i] = 0;
+				t_max[i] = std::numeric_limits<float>::infinity();
+				t_delta[i] = std::numeric_limits<float>::infinity();
+			}
+		}
+
+		// visit the cells within reach of the current cell, after a step only the face of cells that came into reach
+		auto visit = [this, &coord, &reach, &test_cell](int axis, int axis_step) {
+			long lower[dims];
+			long upper[dims];
+			for (uint i = 0; i < dims; ++i) {
+				lower[i] = coord[i] - reach[i];
+				upper[i] = coord[i] + reach[i];
+			}
+			if (axis >= 0) {
+				lower[axis] = upper[axis] = coord[axis] + axis_step * reach[axis];
+			}
+			long offset[dims];
+			for (uint i = 0; i < dims; ++i) {
+				offset[i] = lower[i];
+			}
+			while (true) {
+				uint cell = 0;
+				for (uint i = dims; i-- > 0;) {
+					long count = static_cast<long>(this->_cell_counts[i]);
+					cell = cell * this->_cell_counts[i] + static_cast<uint>((offset[i] % count + count) % count);
+				}
+				test_cell(cell);
+
+				uint i = 0;
+				for (; i < dims && ++offset[i] > upper[i]; ++i) {
+					offset[i] = lower[i];
+				}
+				if (i == dims)
+					return;
+			}
+		};
+
+		int axis = -1;
+		int axis_step = 0;
+		while (true) {
+			visit(axis, axis_step);
+			axis = 0;
+			for (uint i = 1; i < dims; ++i) {
+				if (t_max[i] < t_max[axis]) {
+					axis = static_cast<int>(i);
 				}
 			}
+			// a nearer hit would have to be in reach of a cell the ray entered before the hit
+			float t_enter = t_max[axis];
+			if (!(t_enter <= length) || (found && t_enter > best_toi * length)) {
+				break;
+			}
+			coord[axis] += step[axis];
+			t_max[axis] += t_delta[axis];
+			axis_step = step[axis];
 		}
 	}
-	return retval;
+
+	if (found) {
+		hit.distance = best_toi * length;
+	}
+	return found;
 }
 
 template <mv::uint dims>
-template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
-std::vector<mv::Entity<3>*> mv::Universe<dims>::Gridspace::entities_in_range(const position_type&, float) const
+const std::vector<mv::Contact<dims>>& mv::Universe<dims>::Gridspace::contacts() const
 {
-	static std::vector<mv::Entity<3>*> retval;
+	return this->_contacts;
+}
 
-	return retval;
+template <mv::uint dims>
+const std::vector<mv::Overlap>& mv::Universe<dims>::Gridspace::overlaps() const
+{
+	return this->_overlaps;
 }
 
 
@@ -316,9 +1011,12 @@ inline mv::uint mv::Universe<dims>::Gridspace::_calculate_cell(const position_ty
 
 template <mv::uint dims>
 template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
-inline mv::uint mv::Universe<dims>::Gridspace::_calculate_cell(const position_type&) const
+inline mv::uint mv::Universe<dims>::Gridspace::_calculate_cell(const position_type& position) const
 {
-	return 0;
+	uint x = this->_calculate_grid_coord(position.x(), 0);
+	uint y = this->_calculate_grid_coord(position.y(), 1);
+	uint z = this->_calculate_grid_coord(position.z(), 2);
+	return x + this->_cell_counts[0] * (y + this->_cell_counts[1] * z);
 }
 
 template <mv::uint dims>
@@ -330,6 +1028,437 @@ inline mv::uint mv::Universe<dims>::Gridspace::_calculate_grid_coord(float world
 	return mod(world_coord / this->_cell_sizes[coord_idx], this->_cell_counts[coord_idx]);
 }
 
+template <mv::uint dims>
+template <typename F>
+inline bool mv::Universe<dims>::Gridspace::_for_each_cell(const position_type& lower, const position_type& upper, F&& f) const
+{
+	// first cell and amount of cells to visit along each axis, wrapping around the end of the grid
+	uint first[dims];
+	uint count[dims];
+	for (uint i = 0; i < dims; ++i) {
+		if (upper[i] - lower[i] < this->_cell_sizes[i] * static_cast<float>(this->_cell_counts[i] - 1)) {
+			first[i] = this->_calculate_grid_coord(lower[i], i);
+			uint last = this->_calculate_grid_coord(upper[i], i);
+			count[i] = (last + this->_cell_counts[i] - first[i]) % this->_cell_counts[i] + 1;
+		}
+		else {
+			first[i] = 0;
+			count[i] = this->_cell_counts[i];
+		}
+	}
+
+	uint offset[dims]{};
+	while (true) {
+		uint cell = 0;
+		for (uint i = dims; i-- > 0;) {
+			cell = cell * this->_cell_counts[i] + (first[i] + offset[i]) % this->_cell_counts[i];
+		}
+		if (!f(cell))
+			return false;
+
+		uint i = 0;
+		for (; i < dims && ++offset[i] == count[i]; ++i) {
+			offset[i] = 0;
+		}
+		if (i == dims)
+			return true;
+	}
+}
+
+template <mv::uint dims>
+template <typename F>
+inline bool mv::Universe<dims>::Gridspace::_for_each_cell(const position_type& origin, float radius, F&& f) const
+{
+	position_type lower = origin;
+	position_type upper = origin;
+	for (uint i = 0; i < dims; ++i) {
+		lower[i] -= radius;
+		upper[i] += radius;
+	}
+	return this->_for_each_cell(lower, upper, std::forward<F>(f));
+}
+
+template <mv::uint dims>
+inline bool mv::Universe<dims>::Gridspace::_matches(const Entity<dims>& entity, CollisionLayerMask layers) const
+{
+	return layers == all_collision_layers || (entity.collision_layers() & layers) != 0;
+}
+
+template <mv::uint dims>
+inline bool mv::Universe<dims>::Gridspace::_matches(const StaticEntry& entry, CollisionLayerMask layers) const
+{
+	return layers == all_collision_layers || (entry.layers & layers) != 0;
+}
+
+template <mv::uint dims>
+mv::CollisionLayerMask mv::Universe<dims>::Gridspace::_layers(const std::vector<id_type>& entity_ids) const
+{
+	CollisionLayerMask layers = 0;
+	for (id_type entity_id : entity_ids) {
+		layers |= mv::Multiverse::entity<dims>(entity_id)._collision_layers;
+	}
+	return layers;
+}
+
+template <mv::uint dims>
+mv::CollisionLayerMask mv::Universe<dims>::Gridspace::_layers(const std::vector<StaticGroup>& groups) const
+{
+	CollisionLayerMask layers = 0;
+	for (const StaticGroup& group : groups) {
+		for (const StaticEntry& entry : group.entries) {
+			layers |= entry.layers;
+		}
+	}
+	return layers;
+}
+
+template <mv::uint dims>
+template <typename F>
+inline bool mv::Universe<dims>::Gridspace::_for_each_static(const Cell& cell, F&& f) const
+{
+	for (const StaticGroup& group : cell.static_groups) {
+		for (const StaticEntry& entry : group.entries) {
+			position_type position;
+			for (uint i = 0; i < dims; ++i) {
+				position[i] = (static_cast<float>(group.origin[i]) + static_cast<float>(entry.offset[i]) * (1.f / 65536.f)) * this->_cell_sizes[i];
+			}
+			if (!f(entry, position)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_add_static(Cell& cell, const Entity<dims>& entity)
+{
+	int32 origin[dims];
+	StaticEntry entry{ entity.id(), {}, entity._collision_layers };
+	for (uint i = 0; i < dims; ++i) {
+		float coord = entity._latest_transform().translate[i] / this->_cell_sizes[i];
+		float floor = std::floor(coord);
+		origin[i] = static_cast<int32>(floor);
+		entry.offset[i] = static_cast<uint16>(std::min((coord - floor) * 65536.f, 65535.f));
+	}
+	auto group_it = std::find_if(cell.static_groups.begin(), cell.static_groups.end(), [&origin](const StaticGroup& group) {
+		return std::equal(origin, origin + dims, group.origin);
+	});
+	if (group_it == cell.static_groups.end()) {
+		cell.static_groups.emplace_back();
+		group_it = cell.static_groups.end() - 1;
+		std::copy(origin, origin + dims, group_it->origin);
+	}
+	group_it->entries.push_back(entry);
+	cell.static_layers |= entry.layers;
+}
+
+template <mv::uint dims>
+typename mv::Universe<dims>::Gridspace::StaticEntry* mv::Universe<dims>::Gridspace::_find_static(
+	Cell& cell, id_type entity_id, StaticGroup*& group)
+{
+	for (StaticGroup& g : cell.static_groups) {
+		for (StaticEntry& entry : g.entries) {
+			if (entry.entity_id == entity_id) {
+				group = &g;
+				return &entry;
+			}
+		}
+	}
+	return nullptr;
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_remove_static(Cell& cell, StaticGroup& group, StaticEntry& entry)
+{
+	entry = group.entries.back();
+	group.entries.pop_back();
+	if (group.entries.empty()) {
+		std::swap(group, cell.static_groups.back());
+		cell.static_groups.pop_back();
+	}
+	cell.static_layers = this->_layers(cell.static_groups);
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_wide_bounds(const Entity<dims>& entity, position_type& lower, position_type& upper) const
+{
+	// static colliders are placed once when added, so their bounds stay valid
+	lower = entity._colliders[0]._placement.lower;
+	upper = entity._colliders[0]._placement.upper;
+	for (const Collider<dims>& collider : entity._colliders) {
+		for (uint i = 0; i < dims; ++i) {
+			lower[i] = std::min(lower[i], collider._placement.lower[i]);
+			upper[i] = std::max(upper[i], collider._placement.upper[i]);
+		}
+	}
+}
+
+template <mv::uint dims>
+typename mv::Universe<dims>::position_type mv::Universe<dims>::Gridspace::_wide_closest(const Entity<dims>& entity, const position_type& point) const
+{
+	position_type lower, upper;
+	this->_wide_bounds(entity, lower, upper);
+	position_type closest;
+	for (uint i = 0; i < dims; ++i) {
+		closest[i] = std::min(std::max(point[i], lower[i]), upper[i]);
+	}
+	return closest;
+}
+
+template <mv::uint dims>
+inline mv::uint mv::Universe<dims>::Gridspace::_row_count() const
+{
+	return this->_cell_counts[dims - 1];
+}
+
+template <mv::uint dims>
+inline mv::uint mv::Universe<dims>::Gridspace::_row_size() const
+{
+	uint size = 1;
+	for (uint i = 0; i < dims - 1; ++i) {
+		size *= this->_cell_counts[i];
+	}
+	return size;
+}
+
+template <mv::uint dims>
+inline float mv::Universe<dims>::Gridspace::_scan_radius() const
+{
+	return this->_cell_sizes[0]; // bad value for scan radius, obviously will miss some objects larger than a cell
+}
+
+template <mv::uint dims>
+mv::uint mv::Universe<dims>::Gridspace::_stripe_count() const
+{
+	uint rows = this->_row_count();
+	float row_height = this->_cell_sizes[dims - 1];
+	float radius = this->_scan_radius();
+	if (!(radius * 2.f < row_height * static_cast<float>(rows - 1)))
+		return 1; // every entity scans all rows
+
+	// an entity reaches at most reach rows past its own, stripes of at least 2 * reach rows
+	// keep two stripes on either side of a third from reaching the same row
+	uint reach = static_cast<uint>(std::ceil(radius / row_height));
+	uint stripe_height = std::max(1u, 2 * reach);
+	uint stripe_count = rows / stripe_height;
+	return stripe_count < 2 ? 1 : stripe_count;
+}
+
+template <mv::uint dims>
+inline mv::uint mv::Universe<dims>::Gridspace::_stripe_colour(uint stripe, uint stripe_count) const
+{
+	// rows wrap around, so with an odd amount of stripes the last one borders stripes of both other colours
+	if (stripe_count > 1 && stripe_count % 2 == 1 && stripe == stripe_count - 1)
+		return 2;
+	return stripe % 2;
+}
+
+template <mv::uint dims>
+bool mv::Universe<dims>::Gridspace::_sleep(Entity<dims>& entity)
+{
+	// postphysics components may set the velocity while cells are updated. The sleep state is stored before the
+	// velocity is read and set_velocity does the reverse, so at least one side sees the other: either this finds
+	// the velocity, or wake finds the entity asleep and waits on the lock for the outcome.
+	std::lock_guard<std::mutex> lock(this->_wake_mutex);
+	entity._sleeping = true;
+	if (entity._motion->has_velocity) {
+		entity._sleeping = false;
+		return false;
+	}
+	return true;
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_apply_wakes()
+{
+	std::lock_guard<std::mutex> lock(this->_wake_mutex);
+	for (id_type entity_id : this->_woken_entity_ids) {
+		Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+		Cell& cell = this->_cells[e._gridspace_cell_idx];
+		auto it = std::find(cell.sleeping_entity_ids.begin(), cell.sleeping_entity_ids.end(), entity_id);
+		*it = cell.sleeping_entity_ids.back();
+		cell.sleeping_entity_ids.pop_back();
+		cell.dynamic_entity_ids.push_back(entity_id);
+		cell.dynamic_layers |= e._collision_layers;
+	}
+	// sleeping layers are only rebuilt for cells that lost an entity
+	for (id_type entity_id : this->_woken_entity_ids) {
+		Cell& cell = this->_cells[mv::Multiverse::entity<dims>(entity_id)._gridspace_cell_idx];
+		cell.sleeping_layers = this->_layers(cell.sleeping_entity_ids);
+	}
+	this->_woken_entity_ids.clear();
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_sweep_continuous()
+{
+	this->_sweep_ids.clear();
+	for (const std::vector<id_type>& sweeps : this->_sweeps) {
+		this->_sweep_ids.insert(this->_sweep_ids.end(), sweeps.begin(), sweeps.end());
+	}
+	if (this->_sweep_ids.empty()) {
+		return;
+	}
+
+	// every entity is at the end of its movement, sweeps only read placements so they are found in parallel
+	this->_sweep_tois.assign(this->_sweep_ids.size(), 1.f);
+	float radius = this->_scan_radius();
+	mv::Multiverse::thread_pool().parallel_for(this->_sweep_ids.size(), [this, radius](size_type i) {
+		id_type a_id = this->_sweep_ids[i];
+		const Entity<dims>& a = mv::Multiverse::entity<dims>(a_id);
+		CollisionLayerMask a_layers = a._interaction_layers(this->_layer_interactions);
+		if (!a_layers) {
+			return;
+		}
+		// cells covered by the movement, widened like the discrete scan
+		position_type lower = a._snapshot_transform(this->_tick).translate;
+		position_type upper = lower;
+		for (uint d = 0; d < dims; ++d) {
+			lower[d] = std::min(lower[d], lower[d] - a._motion->sweep[d]) - radius;
+			upper[d] = std::max(upper[d], upper[d] - a._motion->sweep[d]) + radius;
+		}
+		float toi = 1.f;
+		this->_for_each_cell(lower, upper, [this, &a, a_id, a_layers, &toi](uint cell) {
+			const Cell& c = this->_cells[cell];
+			if (c.static_layers & a_layers) {
+				for (const StaticGroup& group : c.static_groups) {
+					for (const StaticEntry& entry : group.entries) {
+						if (entry.layers & a_layers) {
+							a._sweep_collision(mv::Multiverse::entity<dims>(entry.entity_id), this->_layer_interactions, this->_contacts, toi);
+						}
+					}
+				}
+			}
+			for (const std::vector<id_type>* ids : {
+				c.sleeping_layers & a_layers ? &c.sleeping_entity_ids : nullptr,
+				c.dynamic_layers & a_layers ? &c.dynamic_entity_ids : nullptr }) {
+				if (!ids) {
+					continue;
+				}
+				for (id_type b_id : *ids) {
+					const Entity<dims>& b = mv::Multiverse::entity<dims>(b_id);
+					if (b_id != a_id && (b._collision_layers & a_layers)) {
+						a._sweep_collision(b, this->_layer_interactions, this->_contacts, toi);
+					}
+				}
+			}
+			return true;
+		});
+		for (id_type b_id : this->_wide_entity_ids) {
+			const Entity<dims>& b = mv::Multiverse::entity<dims>(b_id);
+			if (b._collision_layers & a_layers) {
+				a._sweep_collision(b, this->_layer_interactions, this->_contacts, toi);
+			}
+		}
+		this->_sweep_tois[i] = toi;
+	});
+
+	// entities are stopped at their first touch, the discrete collision update then resolves the contact
+	for (size_type i = 0; i < this->_sweep_ids.size(); ++i) {
+		float toi = this->_sweep_tois[i];
+		if (toi >= 1.f) {
+			continue;
+		}
+		id_type entity_id = this->_sweep_ids[i];
+		Entity<dims>& e = mv::Multiverse::entity<dims>(entity_id);
+#ifdef _DEBUG
+		if (e._written_in(this->_tick)) {
+			throw std::logic_error("Universe::Gridspace::_sweep_continuous: transform written while cells were updated");
+		}
+#endif
+		// not written since the tick advanced, so the latest transform is the snapshot and both move back
+		transform_type& transform = e._slot(e._transform_state & 1u);
+		position_type back = e._motion->sweep * (1.f - toi);
+		transform.translate -= back;
+		e._motion->sweep -= back;
+		e._update_placements(this->_tick);
+		uint cell = this->_calculate_cell(transform.translate);
+		if (cell != e._gridspace_cell_idx) {
+			std::vector<id_type>& ids = this->_cells[e._gridspace_cell_idx].dynamic_entity_ids;
+			auto it = std::find(ids.begin(), ids.end(), entity_id);
+			*it = ids.back();
+			ids.pop_back();
+			this->_cells[cell].dynamic_entity_ids.push_back(entity_id);
+			this->_cells[cell].dynamic_layers |= e._collision_layers;
+			e._gridspace_cell_idx = cell;
+		}
+	}
+}
+
+template <mv::uint dims>
+inline void mv::Universe<dims>::Gridspace::_stripe_rows(uint stripe, uint stripe_count, uint& first_row, uint& last_row) const
+{
+	uint rows = this->_row_count();
+	first_row = stripe * rows / stripe_count;
+	last_row = (stripe + 1) * rows / stripe_count;
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::Gridspace::_solve_contacts(StripeContacts& stripe_contacts) const
+{
+	const CollisionBatch<dims>& batch = stripe_contacts.batch;
+	std::vector<SolverContact>& contacts = stripe_contacts.contacts;
+	contacts.clear();
+	for (size_type i = 0; i < batch.size(); ++i) {
+		if (stripe_contacts.sides[i] || !batch.hit(i)) {
+			continue; // overlapping pairs are not pushed apart
+		}
+		const ContactKey& key = stripe_contacts.keys[i];
+		SolverContact contact{};
+		contact.entities[0] = &mv::Multiverse::entity<dims>(key.entity0);
+		contact.entities[1] = &mv::Multiverse::entity<dims>(key.entity1);
+		contact.weights[0] = contact.entities[1]->is_static() ? 1.f : 0.5f;
+		contact.weights[1] = 1.f - contact.weights[0];
+		contact.contact.key = key;
+		contact.contact.depth = static_cast<float>(batch.mtv(i).magnitude());
+		contact.contact.normal = contact.contact.depth > 0.f ? batch.mtv(i) / contact.contact.depth : position_type{};
+		contact.contact.hints = batch.hints(i);
+		const auto& placement0 = contact.entities[0]->_colliders[key.collider0].placement();
+		const auto& placement1 = contact.entities[1]->_colliders[key.collider1].placement();
+		for (uint d = 0; d < dims; ++d) {
+			contact.contact.point[d] = (std::max(placement0.lower[d], placement1.lower[d]) + std::min(placement0.upper[d], placement1.upper[d])) * 0.5f;
+		}
+
+		// warm start with the correction of the same collider pair in the previous update
+		const Contact<dims>* cached = stripe_contacts.cached[i];
+		contact.contact.correction = cached ? cached->correction : 0.f;
+		contacts.push_back(contact);
+	}
+
+	// fixed order, so the result does not depend on the order pairs were found in
+	std::sort(contacts.begin(), contacts.end(), [](const SolverContact& lhs, const SolverContact& rhs) {
+		return lhs.contact.key < rhs.contact.key;
+	});
+
+	uint tick = this->_tick;
+	auto push = [](SolverContact& contact, float amount) {
+		contact.entities[0]->_move_transform(contact.contact.normal * (amount * contact.weights[0]));
+		if (contact.weights[1] != 0.f) { // static entities are shared between stripes and never written
+			contact.entities[1]->_move_transform(contact.contact.normal * -(amount * contact.weights[1]));
+		}
+	};
+	for (SolverContact& contact : contacts) {
+		push(contact, contact.contact.correction);
+		if (contact.entities[1]->_sleeping) {
+			contact.entities[1]->_wake();
+		}
+	}
+
+	// every entity starts the collision update at its snapshot, so the difference is the correction applied so far
+	for (uint iteration = 0; iteration < MV_CONTACT_ITERATIONS; ++iteration) {
+		for (SolverContact& contact : contacts) {
+			const Entity<dims>& e0 = *contact.entities[0];
+			const Entity<dims>& e1 = *contact.entities[1];
+			position_type separation = (e0._latest_transform().translate - e0._snapshot_transform(tick).translate) -
+				(e1._latest_transform().translate - e1._snapshot_transform(tick).translate);
+			float correction = std::max(contact.contact.correction + contact.contact.depth - contact.contact.normal.dot(separation), 0.f);
+			push(contact, correction - contact.contact.correction);
+			contact.contact.correction = correction;
+		}
+	}
+}
+
 
 
 
@@ -342,7 +1471,10 @@ mv::Universe<dims>::Universe(
 	_behaviour_updaters{}, _prerender_updaters{}, _render_updaters{},
 	_update_interval{ 0.f }, _update_timeout{ 0.f }, _render_interval{ 0.f }, _render_timeout{ 0.f },
 	_update_enabled{ true }, _render_enabled{ true },
-	_transform_readonly{ false }, _transform_read_buffer{ false }
+	_transform_readonly{ false }, _transform_read_buffer{ false },
+	_since_update{ 0.f }, _update_period{ 0.f }, _render_alpha{ 1.f },
+	_tick_transforms{}, _tick_entity_ids{}, _tick_slot{ 0 }, _render_transforms{}, _render_matrices{},
+	_hierarchy{}
 {}
 
 template <mv::uint dims>
@@ -354,7 +1486,10 @@ mv::Universe<dims>::Universe(
 	_behaviour_updaters{}, _prerender_updaters{}, _render_updaters{},
 	_update_interval{ 0.f }, _update_timeout{ 0.f }, _render_interval{ 0.f }, _render_timeout{ 0.f },
 	_update_enabled{ true }, _render_enabled{ true },
-	_transform_readonly{ false }, _transform_read_buffer{ false }
+	_transform_readonly{ false }, _transform_read_buffer{ false },
+	_since_update{ 0.f }, _update_period{ 0.f }, _render_alpha{ 1.f },
+	_tick_transforms{}, _tick_entity_ids{}, _tick_slot{ 0 }, _render_transforms{}, _render_matrices{},
+	_hierarchy{}
 {}
 
 
@@ -367,6 +1502,18 @@ void mv::Universe<dims>::add_entity(id_type entity_id)
 template <mv::uint dims>
 void mv::Universe<dims>::remove_entity(id_type entity_id)
 {
+	if (this->_hierarchy.contains(entity_id)) {
+		std::vector<id_type> neighbours;
+		this->_hierarchy.children(entity_id, neighbours);
+		if (this->_hierarchy.parent(entity_id) != invalid_id) {
+			neighbours.push_back(this->_hierarchy.parent(entity_id));
+		}
+		this->_hierarchy.remove(entity_id);
+		// parent and children left without relatives are not kept as trees of their own
+		for (id_type neighbour_id : neighbours) {
+			this->_hierarchy.prune(neighbour_id);
+		}
+	}
 	this->_gridspace.remove(entity_id);
 }
 
@@ -400,11 +1547,14 @@ void mv::Universe<dims>::remove_component(UpdateStage stage, type_id_type compon
 template <mv::uint dims>
 void mv::Universe<dims>::update(float delta_time)
 {
+	this->_since_update += delta_time;
 	if (!this->_update_enabled || (this->_update_timeout -= delta_time) >= 0.f)
 		return;
 
 	this->_update_timeout += this->_update_interval;
 	this->_update_timeout = this->_update_timeout >= 0.f ? this->_update_timeout : 0.f;
+	this->_update_period = this->_since_update;
+	this->_since_update = 0.f;
 
 
 	this->_transform_read_buffer = false;
@@ -413,26 +1563,29 @@ void mv::Universe<dims>::update(float delta_time)
 	}
 
 	this->_transform_readonly = true;
-	std::future<void> gridspace_update_result = Multiverse::thread_pool().enqueue(&Gridspace::template update_cells<dims>, std::ref(this->_gridspace));
+	std::future<void> gridspace_update_result = Multiverse::thread_pool().enqueue(&Gridspace::update_cells, std::ref(this->_gridspace));
 	for (ComponentUpdaterBase<UpdateStage::postphysics>* updater : this->_postphysics_updaters) {
 		updater->update(delta_time);
 	}
 	gridspace_update_result.get();
 	this->_transform_read_buffer = true;
-	std::future<void> collision_update_result = Multiverse::thread_pool().enqueue(&Gridspace::template update_collision<dims>, std::cref(this->_gridspace));
+	std::future<void> collision_update_result = Multiverse::thread_pool().enqueue(&Gridspace::update_collision, std::ref(this->_gridspace));
 	for (ComponentUpdaterBase<UpdateStage::input>* updater : this->_input_updaters) {
 		updater->update(delta_time);
 	}
 	collision_update_result.get();
 	this->_transform_readonly = false;
+	this->_gridspace.dispatch_collision_events();
 
 	for (ComponentUpdaterBase<UpdateStage::behaviour>* updater : this->_behaviour_updaters) {
 		updater->update(delta_time);
 	}
+	this->_propagate_hierarchy();
+	this->_record_render_transforms();
 }
 
 template <mv::uint dims>
-void mv::Universe<dims>::render(float delta_time)
+void mv::Universe<dims>::render(float delta_time, float pending_time)
 {
 	if (!this->_render_enabled)
 		return;
@@ -446,6 +1599,9 @@ void mv::Universe<dims>::render(float delta_time)
 		for (ComponentUpdaterBase<UpdateStage::prerender>* updater : this->_prerender_updaters) {
 			updater->update(delta_time);
 		}
+		// frames between updates are drawn between the last two of them
+		this->_render_alpha = this->_update_period > 0.f ? std::min((this->_since_update + pending_time) / this->_update_period, 1.f) : 1.f;
+		this->_compose_render_transforms(this->_render_alpha);
 		// wait for model transform matrices to be calculated
 		this->_transform_readonly = false;
 		for (ComponentUpdaterBase<UpdateStage::render>* updater : this->_render_updaters) {
@@ -470,7 +1626,10 @@ mv::Universe<dims>::Universe(Universe<dims>&& other) noexcept
 	_update_interval{ other._update_interval }, _render_interval{ other._render_interval },
 	_update_timeout{ other._update_timeout }, _render_timeout{ other._render_timeout },
 	_update_enabled{ other._update_enabled }, _render_enabled{ other._render_enabled },
-	_transform_readonly{ other._transform_readonly }, _transform_read_buffer{ other._transform_read_buffer }
+	_transform_readonly{ other._transform_readonly }, _transform_read_buffer{ other._transform_read_buffer },
+	_since_update{ other._since_update }, _update_period{ other._update_period }, _render_alpha{ other._render_alpha },
+	_tick_transforms{}, _tick_entity_ids{}, _tick_slot{ 0 }, _render_transforms{}, _render_matrices{},
+	_hierarchy{ std::move(other._hierarchy) }
 {
 	other._id = invalid_id;
 }
@@ -497,6 +1656,10 @@ mv::Universe<dims>& mv::Universe<dims>::operator=(Universe<dims>&& other) noexce
 	this->_render_enabled = other._render_enabled;
 	this->_transform_readonly = other._transform_readonly;
 	this->_transform_read_buffer = other._transform_read_buffer;
+	this->_since_update = other._since_update;
+	this->_update_period = other._update_period;
+	this->_render_alpha = other._render_alpha;
+	this->_hierarchy = std::move(other._hierarchy);
 	other._id = invalid_id;
 	return *this;
 }
@@ -516,6 +1679,265 @@ mv::Entity<dims>& mv::Universe<dims>::spawn_entity(const transform_type& transfo
 }
 
 
+template <mv::uint dims>
+mv::size_type mv::Universe<dims>::query_radius(const position_type& origin, float radius, Entity<dims>** out, size_type capacity,
+	CollisionLayerMask layers) const
+{
+	QueryOutput<dims> output{ out, capacity, 0 };
+	if (capacity != 0) {
+		this->_gridspace.query_radius(origin, radius, layers, &QueryOutput<dims>::push, &output);
+	}
+	return output.count;
+}
+
+template <mv::uint dims>
+mv::size_type mv::Universe<dims>::query_box(const position_type& lower, const position_type& upper, Entity<dims>** out, size_type capacity,
+	CollisionLayerMask layers) const
+{
+	QueryOutput<dims> output{ out, capacity, 0 };
+	if (capacity != 0) {
+		this->_gridspace.query_box(lower, upper, layers, &QueryOutput<dims>::push, &output);
+	}
+	return output.count;
+}
+
+template <mv::uint dims>
+mv::size_type mv::Universe<dims>::query_ray(const position_type& origin, const position_type& direction, float length, float thickness,
+	Entity<dims>** out, size_type capacity, CollisionLayerMask layers) const
+{
+	QueryOutput<dims> output{ out, capacity, 0 };
+	if (capacity != 0) {
+		this->_gridspace.query_ray(origin, direction, length, thickness, layers, &QueryOutput<dims>::push_ray, &output);
+	}
+	return output.count;
+}
+
+template <mv::uint dims>
+mv::size_type mv::Universe<dims>::query_nearest(const position_type& origin, size_type k, Entity<dims>** out,
+	float max_radius, CollisionLayerMask layers) const
+{
+	return this->_gridspace.query_nearest(origin, k, max_radius, layers, out);
+}
+
+template <mv::uint dims>
+bool mv::Universe<dims>::raycast(const position_type& origin, const position_type& direction, float length, RaycastHit<dims>& hit,
+	CollisionLayerMask layers) const
+{
+	// a ray is a shape without extent: a point in 2D, an empty box in 3D
+	static const CollisionShape<dims> ray = _ray_shape();
+	transform_type transform;
+	transform.translate = origin;
+	return this->shapecast(ray, transform, direction, length, hit, layers);
+}
+
+template <mv::uint dims>
+bool mv::Universe<dims>::shapecast(const CollisionShape<dims>& shape, const transform_type& transform, const position_type& direction, float length,
+	RaycastHit<dims>& hit, CollisionLayerMask layers) const
+{
+	if (!this->_gridspace.cast(shape, shape.place(transform.transform_matrix(), transform.inverse_transform_matrix()), direction, length, layers, hit)) {
+		return false;
+	}
+	hit.point = transform.translate + direction * hit.distance;
+	return true;
+}
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 2, int>::type>
+mv::CollisionShape<dims> mv::Universe<dims>::_ray_shape()
+{
+	return CollisionShape<2>{ CollisionShape<2>::Point{ vec2f{ 0.f, 0.f } } };
+}
+
+template <mv::uint dims>
+template <mv::uint _, typename std::enable_if<_ == 3, int>::type>
+mv::CollisionShape<dims> mv::Universe<dims>::_ray_shape()
+{
+	return CollisionShape<3>{ CollisionShape<3>::Box{ vec3f{ 0.f, 0.f, 0.f }, vec3f{ 0.f, 0.f, 0.f } } };
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::_record_render_transforms()
+{
+	this->_tick_slot ^= 1u;
+	TransformArrays<dims>& transforms = this->_tick_transforms[this->_tick_slot];
+	std::vector<id_type>& entity_ids = this->_tick_entity_ids[this->_tick_slot];
+	transforms.clear();
+	entity_ids.clear();
+	for (ComponentUpdaterBase<UpdateStage::render>* updater : this->_render_updaters) {
+		for (std::size_t i = 0; i < updater->size(); ++i) {
+			const Entity<dims>& entity = updater->at(i).entity();
+			transforms.push_back(entity._latest_transform());
+			entity_ids.push_back(entity.id());
+		}
+	}
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::_compose_render_transforms(float alpha)
+{
+	const TransformArrays<dims>& current = this->_tick_transforms[this->_tick_slot];
+	const TransformArrays<dims>& previous = this->_tick_transforms[this->_tick_slot ^ 1u];
+	std::size_t count = 0;
+	for (ComponentUpdaterBase<UpdateStage::render>* updater : this->_render_updaters) {
+		count += updater->size();
+	}
+
+	const TransformArrays<dims>* transforms = &current;
+	if (count != current.size()) {
+		// render components were added or removed since the last update, there is nothing to interpolate
+		this->_render_transforms.clear();
+		for (ComponentUpdaterBase<UpdateStage::render>* updater : this->_render_updaters) {
+			for (std::size_t i = 0; i < updater->size(); ++i) {
+				this->_render_transforms.push_back(updater->at(i).entity()._latest_transform());
+			}
+		}
+		transforms = &this->_render_transforms;
+	}
+	else if (alpha < 1.f && this->_tick_entity_ids[0] == this->_tick_entity_ids[1]) {
+		batch::interpolate(previous, current, alpha, this->_render_transforms);
+		transforms = &this->_render_transforms;
+	}
+	this->_render_matrices.resize(transforms->size());
+	batch::compose(*transforms, this->_render_matrices.data());
+
+	std::size_t k = 0;
+	for (ComponentUpdaterBase<UpdateStage::render>* updater : this->_render_updaters) {
+		for (std::size_t i = 0; i < updater->size(); ++i) {
+			updater->at(i).transform = this->_render_matrices[k++];
+		}
+	}
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::_propagate_hierarchy()
+{
+	this->_hierarchy.build();
+	Multiverse::thread_pool().parallel_for(this->_hierarchy.tree_count(), [this](size_type tree) {
+		// roots and children moved during the update by set_transform, the solver or components are taken over
+		this->_hierarchy.sync(tree, [](id_type entity_id) -> const transform_type& {
+			return Multiverse::entity<dims>(entity_id)._latest_transform();
+		});
+		this->_hierarchy.propagate(tree, [](id_type entity_id, const transform_type& world) {
+			Entity<dims>& entity = Multiverse::entity<dims>(entity_id);
+			entity._write_transform(world);
+			entity._wake();
+		});
+	});
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::resolve_queries(SpatialQueryBatch<dims>& batch) const
+{
+	using Query = typename SpatialQueryBatch<dims>::Query;
+	using CellQuery = typename SpatialQueryBatch<dims>::CellQuery;
+	constexpr size_type chunk_size = 64; // pairs per task
+	size_type query_count = batch.size();
+
+	batch._pairs.clear();
+	for (size_type q = 0; q < query_count; ++q) {
+		batch._cells.clear();
+		this->_gridspace.cells(batch._queries[q].lower, batch._queries[q].upper, batch._cells);
+		for (uint cell : batch._cells) {
+			batch._pairs.push_back(CellQuery{ cell, q });
+		}
+	}
+	std::sort(batch._pairs.begin(), batch._pairs.end(), [](const CellQuery& lhs, const CellQuery& rhs) {
+		return lhs.cell < rhs.cell || (lhs.cell == rhs.cell && lhs.query < rhs.query);
+	});
+	size_type pair_count = static_cast<size_type>(batch._pairs.size());
+	size_type chunk_count = (pair_count + chunk_size - 1) / chunk_size;
+
+	if (batch._chunks.size() < chunk_count) {
+		batch._chunks.resize(chunk_count);
+	}
+	Multiverse::thread_pool().parallel_for(chunk_count, [this, &batch, pair_count](size_type c) {
+		typename SpatialQueryBatch<dims>::Chunk& chunk = batch._chunks[c];
+		chunk.results.clear();
+		chunk.counts.clear();
+		size_type first_pair = c * chunk_size;
+		for (size_type i = first_pair; i < std::min(first_pair + chunk_size, pair_count); ++i) {
+			const CellQuery& pair = batch._pairs[i];
+			// the cell is gathered once for all of its queries, a cell split between chunks is gathered by both
+			// wide entities are positioned relative to each query, so they are gathered for every query
+			const Query& query = batch._queries[pair.query];
+			if (i == first_pair || pair.cell != batch._pairs[i - 1].cell || pair.cell == Gridspace::wide_cell) {
+				chunk.entities.clear();
+				chunk.positions.clear();
+				chunk.layers.clear();
+				this->_gridspace.gather(pair.cell, query.origin, chunk.entities, chunk.positions, chunk.layers);
+			}
+
+			float sqr_radius = query.radius * query.radius;
+			size_type first = static_cast<size_type>(chunk.results.size());
+			for (size_type j = 0; j < chunk.entities.size(); ++j) {
+				if (query.layers != all_collision_layers && (chunk.layers[j] & query.layers) == 0)
+					continue;
+				const position_type& position = chunk.positions[j];
+				bool inside = true;
+				if (query.radius < 0.f) {
+					for (uint k = 0; k < dims; ++k) {
+						inside = inside && !(position[k] < query.lower[k] || query.upper[k] < position[k]);
+					}
+				}
+				else {
+					inside = (position - query.origin).squared_magnitude() < sqr_radius;
+				}
+				if (inside) {
+					chunk.results.push_back(chunk.entities[j]);
+				}
+			}
+			chunk.counts.push_back(static_cast<size_type>(chunk.results.size()) - first);
+		}
+	});
+
+	// offsets are in query order, the results of a query are spread over the pairs of its cells
+	batch._offsets.assign(query_count + 1, 0);
+	for (size_type i = 0; i < pair_count; ++i) {
+		batch._offsets[batch._pairs[i].query + 1] += batch._chunks[i / chunk_size].counts[i % chunk_size];
+	}
+	for (size_type i = 0; i < query_count; ++i) {
+		batch._offsets[i + 1] += batch._offsets[i];
+	}
+	batch._results.resize(batch._offsets[query_count]);
+	batch._cursors.assign(batch._offsets.begin(), batch._offsets.end() - 1);
+	for (size_type c = 0; c < chunk_count; ++c) {
+		typename SpatialQueryBatch<dims>::Chunk& chunk = batch._chunks[c];
+		auto source = chunk.results.cbegin();
+		for (size_type i = c * chunk_size; i < std::min((c + 1) * chunk_size, pair_count); ++i) {
+			size_type count = chunk.counts[i % chunk_size];
+			size_type& cursor = batch._cursors[batch._pairs[i].query];
+			std::copy(source, source + count, batch._results.begin() + cursor);
+			cursor += count;
+			source += count;
+		}
+	}
+}
+
+template <mv::uint dims>
+const std::vector<mv::Contact<dims>>& mv::Universe<dims>::contacts() const
+{
+	return this->_gridspace.contacts();
+}
+
+template <mv::uint dims>
+const std::vector<mv::Overlap>& mv::Universe<dims>::overlaps() const
+{
+	return this->_gridspace.overlaps();
+}
+
+template <mv::uint dims>
+void mv::Universe<dims>::set_layer_interaction(CollisionLayer layer0, CollisionLayer layer1, bool interact)
+{
+	this->_gridspace.set_layer_interaction(layer0, layer1, interact);
+}
+
+template <mv::uint dims>
+bool mv::Universe<dims>::layers_interact(CollisionLayer layer0, CollisionLayer layer1) const
+{
+	return (this->_gridspace.layer_interactions(layer0) & collision_layer_mask(layer1)) != 0;
+}
+
+
 template <mv::uint dims>
 void mv::Universe<dims>::set_update_interval(float interval)
 {
@@ -542,6 +1964,12 @@ void mv::Universe<dims>::set_render_enabled(bool enabled)
 	this->_render_enabled = enabled;
 }
 
+template <mv::uint dims>
+float mv::Universe<dims>::render_alpha() const
+{
+	return this->_render_alpha;
+}
+
 
 
 
@@ -554,8 +1982,6 @@ template class mv::Universe<2>::ComponentUpdaterList<mv::UpdateStage::postphysic
 template class mv::Universe<2>::ComponentUpdaterList<mv::UpdateStage::prerender>;
 template class mv::Universe<2>::ComponentUpdaterList<mv::UpdateStage::render>;
 template mv::Universe<2>::Gridspace::Gridspace(uint, uint, float, float);
-template void mv::Universe<2>::Gridspace::update_cells();
-template std::vector<mv::Entity<2>*> mv::Universe<2>::Gridspace::entities_in_range(const position_type&, float) const;
 template mv::uint mv::Universe<2>::Gridspace::_cell_count() const;
 template mv::uint mv::Universe<2>::Gridspace::_calculate_cell(const position_type&) const;
 template class mv::Universe<3>;
@@ -567,7 +1993,5 @@ template class mv::Universe<3>::ComponentUpdaterList<mv::UpdateStage::postphysic
 template class mv::Universe<3>::ComponentUpdaterList<mv::UpdateStage::prerender>;
 template class mv::Universe<3>::ComponentUpdaterList<mv::UpdateStage::render>;
 template mv::Universe<3>::Gridspace::Gridspace(uint, uint, uint, float, float, float);
-template void mv::Universe<3>::Gridspace::update_cells();
-template std::vector<mv::Entity<3>*> mv::Universe<3>::Gridspace::entities_in_range(const position_type&, float) const;
 template mv::uint mv::Universe<3>::Gridspace::_cell_count() const;
 template mv::uint mv::Universe<3>::Gridspace::_calculate_cell(const position_type&) const;
@@ -1,11 +1,20 @@
 #pragma once
 #include "setup.h"
 
+#include <limits>
+#include <mutex>
+#include <utility>
 #include <vector>
 #include <map>
 
 #include "UpdateStage.h"
 #include "Transform.h"
+#include "Collider.h"
+#include "CollisionBatch.h"
+#include "Contact.h"
+#include "SpatialQueryBatch.h"
+#include "BatchMath.h"
+#include "TransformHierarchy.h"
 
 namespace mv
 {
@@ -102,17 +111,96 @@ namespace mv
 
 		class Gridspace
 		{
+		public:
+			using visitor_type = bool (*)(void* context, Entity<dims>& entity); // returns false to end the query
+			using ray_visitor_type = bool (*)(void* context, Entity<dims>& entity, float distance);
+
+			static constexpr uint wide_cell = ~0u; // stands for the wide static entities in cells and gather
+
 		private:
+			/**
+				\brief compact record of a static entity, enough to test its position and layers without touching the entity
+
+				Static entities never move, so the record stays valid. The position is quantised to 1/65536 of a cell,
+				relative to the origin of the group the entry is in.
+			*/
+			struct StaticEntry
+			{
+				id_type entity_id;
+				uint16 offset[dims]; // position within the cell of the group in 1/65536 of a cell
+				CollisionLayerMask layers;
+			};
+
+			/**
+				\brief static entries of a cell that lie in the same cell of the unwrapped grid
+
+				The grid wraps around, so entities of cells a whole grid apart share a cell. Each group keeps the
+				unwrapped cell once for all its entries, a cell usually has one group.
+			*/
+			struct StaticGroup
+			{
+				int32 origin[dims];
+				std::vector<StaticEntry> entries;
+			};
+
 			struct Cell
 			{
-				std::vector<id_type> static_entity_ids;
+				std::vector<StaticGroup> static_groups;
 				std::vector<id_type> dynamic_entity_ids;
-				uint count;
+				std::vector<id_type> sleeping_entity_ids; // dynamic entities at rest, not updated and only collided against
+				// layers of the colliders in each list, may include layers that have since left the list
+				CollisionLayerMask static_layers;
+				CollisionLayerMask dynamic_layers;
+				CollisionLayerMask sleeping_layers;
+			};
+
+			struct Migration
+			{
+				id_type entity_id;
+				uint cell;
+				CollisionLayerMask layers;
+			};
+
+			struct SolverContact
+			{
+				Contact<dims> contact;
+				Entity<dims>* entities[2];
+				float weights[2]; // share of the correction each entity takes, 0 for static entities
+			};
+
+			struct StripeContacts
+			{
+				CollisionBatch<dims> batch;
+				std::vector<ContactKey> keys; // collider pair of each pair in the batch
+				std::vector<byte> sides; // overlap sides of each pair in the batch, 0 for blocking pairs
+				std::vector<const Contact<dims>*> cached; // contact of the same blocking pair in the last update, nullptr if none
+				std::vector<SolverContact> contacts;
+				std::vector<Overlap> overlaps;
+			};
+
+			struct OverlapEvent
+			{
+				Overlap overlap; // sides holds the colliders to raise the event on
+				bool begin;
 			};
 
 			Cell* _cells;
 			uint _cell_counts[dims]; // amount of cells allocated for each dimension
 			float _cell_sizes[dims]; // sizes of cells for each dimension
+			std::vector<std::vector<Migration>> _migrations; // dynamic entities leaving their cell per row, applied after the parallel pass
+			std::vector<std::vector<id_type>> _sweeps; // moved entities with continuous colliders per row
+			std::vector<id_type> _sweep_ids;
+			std::vector<float> _sweep_tois; // fraction of the movement each swept entity keeps
+			std::vector<id_type> _woken_entity_ids; // woken entities still in a sleeping list, moved at the next update_cells
+			std::mutex _wake_mutex;
+			std::vector<StripeContacts> _stripe_contacts; // block pairs per stripe, solved together after the stripe is scanned
+			std::vector<Contact<dims>> _contacts; // contacts of the last update sorted by key, warm start the next one
+			CollisionLayerMask _layer_interactions[8]; // layers each layer may interact with, symmetric
+			std::vector<Overlap> _overlaps; // overlaps of the last update sorted by key
+			std::vector<Overlap> _previous_overlaps; // overlaps of the update before, diffed against to find begins and ends
+			std::vector<OverlapEvent> _overlap_events;
+			std::vector<id_type> _wide_entity_ids; // static entities with colliders wider than a cell, not in any cell
+			uint _tick; // advanced by update_cells, which snapshots the transforms of all entities
 
 		public:
 			template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
@@ -130,20 +218,51 @@ namespace mv
 			void add(id_type entity_id);
 			void remove(id_type entity_id);
 
-			template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
-			void update_cells();
-			template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
-			void update_cells();
+			uint cell(const position_type& position) const;
+			/**
+				\brief get the current tick, entity transforms written before it started are its snapshot
+			*/
+			uint tick() const;
+			void wake(Entity<dims>& entity);
+			/**
+				\brief update the cell of an entity after a collider was added to it
 
-			template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
-			void update_collision() const;
-			template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
-			void update_collision() const;
+				Static entities with a collider wider than a cell are moved to a list every dynamic entity collides
+				against, since the scan around an entity only reaches into neighbouring cells.
+			*/
+			void update_colliders(Entity<dims>& entity);
 
-			template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
-			std::vector<Entity<2>*> entities_in_range(const position_type& origin, float radius) const;
-			template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
-			std::vector<Entity<3>*> entities_in_range(const position_type& origin, float radius) const;
+			void set_layer_interaction(CollisionLayer layer0, CollisionLayer layer1, bool interact);
+			CollisionLayerMask layer_interactions(CollisionLayer layer) const;
+
+			void update_cells();
+			void update_collision();
+			void dispatch_collision_events();
+
+			void query_radius(const position_type& origin, float radius, CollisionLayerMask layers, visitor_type visitor, void* context) const;
+			void query_box(const position_type& lower, const position_type& upper, CollisionLayerMask layers, visitor_type visitor, void* context) const;
+			void query_ray(const position_type& origin, const position_type& direction, float length, float thickness,
+				CollisionLayerMask layers, ray_visitor_type visitor, void* context) const;
+			size_type query_nearest(const position_type& origin, size_type k, float max_radius, CollisionLayerMask layers, Entity<dims>** out) const;
+			/**
+				\brief find the first collider hit by shape moving from placement along direction, the point of the hit is not set
+			*/
+			bool cast(const CollisionShape<dims>& shape, const typename CollisionShape<dims>::Placement& placement,
+				const position_type& direction, float length, CollisionLayerMask layers, RaycastHit<dims>& hit) const;
+
+			/**
+				\brief append every cell overlapping the box from lower to upper, each cell once, then wide_cell if there are wide entities
+			*/
+			void cells(const position_type& lower, const position_type& upper, std::vector<uint>& out) const;
+			/**
+				\brief append every entity of a cell with its snapshot position and collision layers
+				\param centre centre of the query, wide entities are positioned at the point of their collider bounds closest to it
+			*/
+			void gather(uint cell, const position_type& centre, std::vector<Entity<dims>*>& entities, std::vector<position_type>& positions,
+				std::vector<CollisionLayerMask>& layers) const;
+
+			const std::vector<Contact<dims>>& contacts() const;
+			const std::vector<Overlap>& overlaps() const;
 
 		private:
 			template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
@@ -156,6 +275,48 @@ namespace mv
 			template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
 			uint _calculate_cell(const position_type& position) const;
 			uint _calculate_grid_coord(float world_coord, uint coord_idx) const;
+			/**
+				\returns false if f ended the visit by returning false
+			*/
+			template <typename F>
+			bool _for_each_cell(const position_type& lower, const position_type& upper, F&& f) const;
+			template <typename F>
+			bool _for_each_cell(const position_type& origin, float radius, F&& f) const;
+			bool _matches(const Entity<dims>& entity, CollisionLayerMask layers) const;
+			bool _matches(const StaticEntry& entry, CollisionLayerMask layers) const;
+			CollisionLayerMask _layers(const std::vector<id_type>& entity_ids) const;
+			CollisionLayerMask _layers(const std::vector<StaticGroup>& groups) const;
+			/**
+				\brief call f(entry, position) for each static entry of cell, with the position restored from the quantised one
+				\returns false if f ended the visit by returning false
+			*/
+			template <typename F>
+			bool _for_each_static(const Cell& cell, F&& f) const;
+			void _add_static(Cell& cell, const Entity<dims>& entity);
+			/**
+				\brief find the entry of a static entity in cell, nullptr if it is not in the cell
+			*/
+			static StaticEntry* _find_static(Cell& cell, id_type entity_id, StaticGroup*& group);
+			/**
+				\brief remove an entry from its group, and the group from cell once it is empty
+			*/
+			void _remove_static(Cell& cell, StaticGroup& group, StaticEntry& entry);
+			/**
+				\brief get the union of the collider bounds of a wide entity, queries test wide entities against it
+			*/
+			void _wide_bounds(const Entity<dims>& entity, position_type& lower, position_type& upper) const;
+			position_type _wide_closest(const Entity<dims>& entity, const position_type& point) const;
+
+			uint _row_count() const;
+			uint _row_size() const;
+			float _scan_radius() const;
+			uint _stripe_count() const;
+			uint _stripe_colour(uint stripe, uint stripe_count) const;
+			bool _sleep(Entity<dims>& entity);
+			void _apply_wakes();
+			void _sweep_continuous();
+			void _stripe_rows(uint stripe, uint stripe_count, uint& first_row, uint& last_row) const;
+			void _solve_contacts(StripeContacts& stripe_contacts) const;
 		};
 
 
@@ -177,8 +338,20 @@ namespace mv
 		bool _update_enabled;
 		bool _render_enabled;
 		
-		bool _transform_readonly;
-		bool _transform_read_buffer;
+		bool _transform_readonly; // components may not set transforms, the gridspace owns them
+		bool _transform_read_buffer; // components read the snapshot transforms, the collision update writes the latest ones
+
+		float _since_update; // time since the last update ran
+		float _update_period; // time between the last two updates
+		float _render_alpha;
+
+		TransformArrays<dims> _tick_transforms[2]; // entity transforms of the render components at the end of the last two updates
+		std::vector<id_type> _tick_entity_ids[2]; // entity of each of _tick_transforms
+		byte _tick_slot; // slot of the last update in _tick_transforms
+		TransformArrays<dims> _render_transforms; // entity transforms of the render components, gathered for batch composition
+		std::vector<Matrix<float, dims + 1, dims + 1>> _render_matrices; // model transforms composed from _render_transforms
+
+		TransformHierarchy<dims> _hierarchy; // parent and child relations of entities, keyed by entity id
 
 
 		template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
@@ -189,6 +362,34 @@ namespace mv
 		void add_entity(id_type entity_id);
 		void remove_entity(id_type entity_id);
 
+		/**
+			\brief get a shape without extent to cast as a ray
+		*/
+		template <uint _ = dims, typename std::enable_if<_ == 2, int>::type = 0>
+		static CollisionShape<dims> _ray_shape();
+		template <uint _ = dims, typename std::enable_if<_ == 3, int>::type = 0>
+		static CollisionShape<dims> _ray_shape();
+		/**
+			\brief store the transforms of the entities of all render components, the end state of this update
+		*/
+		void _record_render_transforms();
+		/**
+			\brief set the model transform of every render component from the transform of its entity
+			\param alpha fraction of the way from the update before the last to the last one
+
+			Render components are drawn between the states the last two updates left them in, so motion stays smooth
+			when frames come faster than updates. Components added since the last update are drawn at their entity's
+			current transform. The transforms are gathered into arrays and composed by one streaming batch kernel.
+		*/
+		void _compose_render_transforms(float alpha);
+		/**
+			\brief move the children in the entity hierarchy along with their parents
+
+			Roots take their local transform from their entity, then every tree is propagated on its own task and the
+			children whose world transform changed get it written as their entity transform.
+		*/
+		void _propagate_hierarchy();
+
 		template <typename ComponentType, typename std::enable_if<std::is_base_of<Component<dims, UpdateStage::physics>, ComponentType>::value, int>::type = 0>
 		ComponentType& get_component(id_type component_id) const;
 		template <typename ComponentType, typename std::enable_if<std::is_base_of<Component<dims, UpdateStage::postphysics>, ComponentType>::value, int>::type = 0>
@@ -229,7 +430,10 @@ namespace mv
 		void remove_component(UpdateStage stage, type_id_type component_type_id, id_type component_id);
 
 		void update(float delta_time);
-		void render(float delta_time);
+		/**
+			\param pending_time time accumulated towards the next tick, which the interpolation of render transforms follows
+		*/
+		void render(float delta_time, float pending_time);
 
 	public:
 		Universe(const Universe<dims>&) = delete;
@@ -245,10 +449,118 @@ namespace mv
 
 		Entity<dims>& spawn_entity(const transform_type& transform = transform_type{}) const;
 
+		/**
+			\brief visit all entities positioned within radius of origin
+			\param visitor callable as bool(Entity<dims>&), returning false ends the query
+			\param layers only visit entities with a collider on one of these layers, all_collision_layers visits every entity
+
+			Queries read the positions of the last gridspace update and do not allocate,
+			so they may run concurrently from parallel component updates.
+			Static entities are tested at their position quantised to 1/65536 of a cell. Static entities with colliders
+			wider than a cell are tested at the point of their collider bounds closest to origin.
+		*/
+		template <typename Visitor>
+		void query_radius(const position_type& origin, float radius, Visitor&& visitor, CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief write entities positioned within radius of origin to out
+			\returns amount of entities written, at most capacity
+		*/
+		size_type query_radius(const position_type& origin, float radius, Entity<dims>** out, size_type capacity,
+			CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief visit all entities positioned inside the axis aligned box from lower to upper
+			\param visitor callable as bool(Entity<dims>&), returning false ends the query
+		*/
+		template <typename Visitor>
+		void query_box(const position_type& lower, const position_type& upper, Visitor&& visitor, CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief write entities positioned inside the axis aligned box from lower to upper to out
+			\returns amount of entities written, at most capacity
+		*/
+		size_type query_box(const position_type& lower, const position_type& upper, Entity<dims>** out, size_type capacity,
+			CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief visit all entities positioned within thickness of a ray
+			\param direction normalised direction of the ray
+			\param length length of the ray
+			\param visitor callable as bool(Entity<dims>&, float), called with the distance along the ray, returning false ends the query
+
+			Entities are not visited in order of distance. Static entities with colliders wider than a cell are visited
+			where the ray enters their collider bounds grown by thickness.
+		*/
+		template <typename Visitor>
+		void query_ray(const position_type& origin, const position_type& direction, float length, float thickness, Visitor&& visitor,
+			CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief write entities positioned within thickness of a ray to out
+			\returns amount of entities written, at most capacity
+		*/
+		size_type query_ray(const position_type& origin, const position_type& direction, float length, float thickness,
+			Entity<dims>** out, size_type capacity, CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief write the k entities nearest to origin to out, nearest first
+			\param max_radius entities further away than this are ignored
+			\returns amount of entities written, at most k
+		*/
+		size_type query_nearest(const position_type& origin, size_type k, Entity<dims>** out,
+			float max_radius = std::numeric_limits<float>::infinity(), CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief find the first collider hit by a ray
+			\param direction normalised direction of the ray
+			\param hit receives the first hit
+			\param layers only hit colliders on one of these layers
+			\returns whether a collider was hit
+
+			Walks the cells along the ray in order and stops once no cell left can hold a nearer hit, so the cost
+			follows the amount of cells crossed. Colliders that already contain the origin are not hit.
+		*/
+		bool raycast(const position_type& origin, const position_type& direction, float length, RaycastHit<dims>& hit,
+			CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief find the first collider hit by a shape moved along a ray
+			\param transform transformation of the shape at the start of the cast
+			\see raycast
+		*/
+		bool shapecast(const CollisionShape<dims>& shape, const transform_type& transform, const position_type& direction, float length,
+			RaycastHit<dims>& hit, CollisionLayerMask layers = all_collision_layers) const;
+		/**
+			\brief resolve all queries of a batch in one parallel pass
+
+			Every query is paired with each cell it overlaps and the pairs are sorted by cell. The entities of a cell are
+			then gathered once and tested against all queries touching it, so a crowded area is read once per batch
+			rather than once per query. Runs of pairs are resolved in parallel chunks.
+		*/
+		void resolve_queries(SpatialQueryBatch<dims>& batch) const;
+
+		/**
+			\brief get all blocking contacts resolved in the last update, sorted by collider pair
+		*/
+		const std::vector<Contact<dims>>& contacts() const;
+		/**
+			\brief get all overlapping collider pairs found in the last update, sorted by collider pair
+		*/
+		const std::vector<Overlap>& overlaps() const;
+
+		/**
+			\brief set whether colliders on two layers can interact at all
+
+			All layers interact by default. Pairs of layers that do not interact are culled while pairs are gathered,
+			before either collider response is looked at; entities whose colliders interact with nothing are never scanned.
+		*/
+		void set_layer_interaction(CollisionLayer layer0, CollisionLayer layer1, bool interact);
+		/**
+			\brief check whether colliders on two layers can interact
+		*/
+		bool layers_interact(CollisionLayer layer0, CollisionLayer layer1) const;
+
 		void set_update_interval(float interval);
 		void set_update_enabled(bool enabled);
 		void set_render_interval(float interval);
 		void set_render_enabled(bool enabled);
+		/**
+			\brief get the fraction of the way between the last two updates that the model transforms were last composed at
+		*/
+		float render_alpha() const;
 	};
 
 
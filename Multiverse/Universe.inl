@@ -255,3 +255,37 @@ inline void mv::Universe<dims>::remove_component(id_type component_id)
 {
 	this->_render_updaters.remove(type_id<ComponentType>(), component_id);
 }
+
+
+
+
+template <mv::uint dims>
+template <typename Visitor>
+inline void mv::Universe<dims>::query_radius(const position_type& origin, float radius, Visitor&& visitor, CollisionLayerMask layers) const
+{
+	using visitor_type = typename std::remove_reference<Visitor>::type;
+	this->_gridspace.query_radius(origin, radius, layers, [](void* context, Entity<dims>& entity) -> bool {
+		return (*static_cast<visitor_type*>(context))(entity);
+	}, const_cast<void*>(static_cast<const void*>(&visitor)));
+}
+
+template <mv::uint dims>
+template <typename Visitor>
+inline void mv::Universe<dims>::query_box(const position_type& lower, const position_type& upper, Visitor&& visitor, CollisionLayerMask layers) const
+{
+	using visitor_type = typename std::remove_reference<Visitor>::type;
+	this->_gridspace.query_box(lower, upper, layers, [](void* context, Entity<dims>& entity) -> bool {
+		return (*static_cast<visitor_type*>(context))(entity);
+	}, const_cast<void*>(static_cast<const void*>(&visitor)));
+}
+
+template <mv::uint dims>
+template <typename Visitor>
+inline void mv::Universe<dims>::query_ray(const position_type& origin, const position_type& direction, float length, float thickness,
+	Visitor&& visitor, CollisionLayerMask layers) const
+{
+	using visitor_type = typename std::remove_reference<Visitor>::type;
+	this->_gridspace.query_ray(origin, direction, length, thickness, layers, [](void* context, Entity<dims>& entity, float distance) -> bool {
+		return (*static_cast<visitor_type*>(context))(entity, distance);
+	}, const_cast<void*>(static_cast<const void*>(&visitor)));
+}
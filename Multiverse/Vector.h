@@ -11,9 +11,10 @@
 
 #pragma once
 #include "setup.h"
+#include "Simd.h" // simd kernels
 
 #include <cstddef> // nullptr_t
-#include <type_traits> // enable_if
+#include <type_traits> // enable_if, is_same
 #include <ostream> // ostream
 #include <utility> // declval
 
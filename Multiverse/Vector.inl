@@ -192,18 +192,22 @@ mv::Vector<T, N, D> mv::Vector<T, N, D>::normalise() const
 template <typename T, unsigned int N, bool D>
 double mv::Vector<T, N, D>::angle(const Vector<T, N, D>& reference) const
 {
-	return std::acos(this->dot(reference) / (this->magnitude() * reference.magnitude()));
+	return std::acos(static_cast<double>(this->dot(reference)) / (this->magnitude() * reference.magnitude()));
 }
 
 template <typename T, unsigned int N, bool D>
 double mv::Vector<T, N, D>::magnitude() const
 {
-	return std::sqrt(this->squared_magnitude());
+	using std::sqrt; // element types such as Fixed provide their own by argument dependent lookup
+	return static_cast<double>(sqrt(this->squared_magnitude()));
 }
 
 template <typename T, unsigned int N, bool D>
 typename mv::Vector<T, N, D>::value_type  mv::Vector<T, N, D>::squared_magnitude() const
 {
+	if constexpr (mv::simd::supported<T, N>::value) {
+		return mv::simd::dot<N>(this->_components, this->_components);
+	}
 	typename mv::Vector<T, N, D>::value_type sum{ 0 };
 	for (unsigned int i{ 0 }; i < this->dimension; ++i) {
 		sum += this->at(i) * this->at(i);
@@ -216,6 +220,9 @@ typename mv::Vector<T, N, D>::value_type  mv::Vector<T, N, D>::squared_magnitude
 template <typename T, unsigned int N, bool D>
 typename mv::Vector<T, N, D>::value_type mv::Vector<T, N, D>::dot(const Vector<T, N, D>& rhs) const
 {
+	if constexpr (mv::simd::supported<T, N>::value) {
+		return mv::simd::dot<N>(this->_components, rhs._components);
+	}
 	typename mv::Vector<T, N, D>::value_type sum{ 0 };
 	for (unsigned int i{ 0 }; i < this->dimension; ++i) {
 		sum += this->at(i) * rhs[i];
@@ -334,6 +341,10 @@ template <typename T, unsigned int N, bool D>
 template <typename _T>
 mv::Vector<T, N, D>& mv::Vector<T, N, D>::operator+=(const mv::Vector<_T, N, D>& rhs)
 {
+	if constexpr (mv::simd::supported<T, N>::value && std::is_same<T, _T>::value) {
+		mv::simd::add<N>(this->_components, &rhs[0]);
+		return *this;
+	}
 	for (unsigned int i{ 0 }; i < this->dimension; ++i) {
 		this->at(i) += rhs[i];
 	}
@@ -353,6 +364,10 @@ template <typename T, unsigned int N, bool D>
 template <typename _T>
 mv::Vector<T, N, D>& mv::Vector<T, N, D>::operator-=(const mv::Vector<_T, N, D>& rhs)
 {
+	if constexpr (mv::simd::supported<T, N>::value && std::is_same<T, _T>::value) {
+		mv::simd::subtract<N>(this->_components, &rhs[0]);
+		return *this;
+	}
 	for (unsigned int i{ 0 }; i < this->dimension; ++i) {
 		this->at(i) -= rhs[i];
 	}
@@ -372,6 +387,10 @@ template <typename T, unsigned int N, bool D>
 template <typename _T>
 mv::Vector<T, N, D>& mv::Vector<T, N, D>::operator*=(const _T& rhs)
 {
+	if constexpr (mv::simd::supported<T, N>::value && std::is_same<T, _T>::value) {
+		mv::simd::scale<N>(this->_components, rhs);
+		return *this;
+	}
 	for (unsigned int i{ 0 }; i < this->dimension; ++i) {
 		this->at(i) *= rhs;
 	}
@@ -7,6 +7,25 @@
 #ifndef MV_CELL_SIZE_DEFAULT
 #define MV_CELL_SIZE_DEFAULT 16.f
 #endif
+#ifndef MV_SLEEP_TICKS
+#define MV_SLEEP_TICKS 30 // ticks a dynamic entity has to be at rest before it is put to sleep
+#endif
+#ifndef MV_CONTACT_ITERATIONS
+#define MV_CONTACT_ITERATIONS 4 // solver passes over the contacts of a stripe per update
+#endif
+#ifndef MV_FIXED_POINT_TRIG
+#define MV_FIXED_POINT_TRIG 0 // take the sine and cosine of rotations from the fixed point table instead of the standard library
+#endif
+#ifndef MV_FAST_TRIG
+#define MV_FAST_TRIG 0 // use the polynomial sine and cosine of BatchMath for transform matrices, accurate to about 2e-7
+#endif
+#ifndef MV_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MV_SIMD 1 // use SSE kernels where available
+#else
+#define MV_SIMD 0
+#endif
+#endif
 
 namespace mv
 {